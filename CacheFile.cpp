@@ -0,0 +1,75 @@
+/**
+ * @file CacheFile.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the shared cache file IO.
+ * @bug No known bugs.
+ */
+
+#include "CacheFile.h"
+
+#include <cstdio>
+
+/**
+ * @brief Reads the whole of the given cache file in a single read.
+ * @param path The path of the cache file.
+ * @param max_size The size of the largest file which may be valid.
+ * @param data Returns the content of the file.
+ * @return True if the file was read, false if it could not be read or is
+ *         larger than max_size.
+ */
+bool
+ReadCacheFile(
+    const std::string &path,
+    size_t max_size,
+    std::vector<unsigned char> &data
+) {
+    FILE *file;
+    if (fopen_s(&file, path.c_str(), "rb") || !file) {
+        return false;
+    }
+
+    bool ok = !_fseeki64(file, 0, SEEK_END);
+    long long size = ok ? _ftelli64(file) : -1;
+    ok = (size >= 0) && (static_cast<unsigned long long>(size) <= max_size)
+      && !_fseeki64(file, 0, SEEK_SET);
+
+    if (ok) {
+        data.resize(static_cast<size_t>(size));
+        ok = fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    fclose(file);
+
+    return ok;
+}
+
+/**
+ * @brief Writes a header and a body to the given cache file.
+ *
+ * If any part of the write fails, the file is removed, so that a partial
+ * cache is never left behind.
+ *
+ * @return True if the cache was written, false otherwise.
+ */
+bool
+WriteCacheFile(
+    const std::string &path,
+    const void *header,
+    size_t header_size,
+    const void *body,
+    size_t body_size
+) {
+    FILE *file;
+    if (fopen_s(&file, path.c_str(), "wb") || !file) {
+        return false;
+    }
+
+    bool ok = fwrite(header, 1, header_size, file) == header_size;
+    ok = ok && (fwrite(body, 1, body_size, file) == body_size);
+    ok = !fclose(file) && ok;
+
+    if (!ok) {
+        remove(path.c_str());
+    }
+
+    return ok;
+}
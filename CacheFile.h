@@ -0,0 +1,66 @@
+/**
+ * @file CacheFile.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes the file IO shared by the caches we keep next to our files.
+ * @bug No known bugs.
+ *
+ * Each cache is a single flat file, starting with a header which begins with
+ * a magic number and a format version. Since the caches are only ever an
+ * optimization, any IO error simply makes the caller fall back to doing the
+ * work the cache would have saved.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_CACHE_FILE_H__
+#define __SKYRIM_UNCAPPER_AE_CACHE_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+bool ReadCacheFile(const std::string &path, size_t max_size,
+                   std::vector<unsigned char> &data);
+bool WriteCacheFile(const std::string &path, const void *header,
+                    size_t header_size, const void *body, size_t body_size);
+
+/**
+ * @brief Creates a cache header with the given magic number and format.
+ *
+ * Everything else is cleared, so the padding in the file is deterministic.
+ */
+template <typename H>
+inline H
+MakeCacheHeader(
+    uint32_t magic,
+    uint32_t format
+) {
+    H header;
+    memset(&header, 0, sizeof(header));
+    header.magic = magic;
+    header.format = format;
+    return header;
+}
+
+/**
+ * @brief Copies the header out of the start of a cache file.
+ * @return True if the file holds a header with the given magic number and
+ *         format, false otherwise.
+ */
+template <typename H>
+inline bool
+ReadCacheHeader(
+    const std::vector<unsigned char> &data,
+    uint32_t magic,
+    uint32_t format,
+    H &header
+) {
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+
+    memcpy(&header, data.data(), sizeof(header));
+    return (header.magic == magic) && (header.format == format);
+}
+
+#endif /* __SKYRIM_UNCAPPER_AE_CACHE_FILE_H__ */
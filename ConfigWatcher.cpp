@@ -0,0 +1,176 @@
+/**
+ * @file ConfigWatcher.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the INI file watcher.
+ * @bug No known bugs.
+ *
+ * The watcher thread waits on change notifications for the directory holding
+ * the INI file. When the write time of the INI changes, the watcher thread
+ * reads it into a fresh settings object, so the game never waits on the parse.
+ * The log isn't synchronized, and the published settings are only changed on
+ * the main thread. So the new settings are handed to an SKSE task, which
+ * publishes them with a single pointer swap and logs the result. The hooks
+ * never lock, and never see a config which is only partially read.
+ */
+
+#include "ConfigWatcher.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <Windows.h>
+
+#include "ReusableTask.h"
+#include "Settings.h"
+
+/// @brief How long, in milliseconds, to let an editor finish saving the INI.
+static const DWORD kSettleTime = 250;
+
+/// @brief The path of the watched INI file.
+static std::string watchPath;
+
+/// @brief The write time of the INI when it was last read. Only used on the
+///        watcher thread, once it has started.
+static uint64_t lastWrite;
+
+/// @brief The settings read by the watcher thread which have yet to be
+///        published, if any.
+static std::atomic<Settings*> reloadedSettings;
+
+/// @brief Set when the watcher thread failed to read a changed INI.
+static std::atomic<bool> reloadFailed;
+
+/// @brief Set once the watcher thread has given up.
+static std::atomic<bool> watcherStopped;
+
+/**
+ * @brief Gets the last write time of the given file.
+ * @return The write time, or 0 if the file does not exist.
+ */
+static uint64_t
+GetLastWriteTime(
+    const std::string &path
+) {
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info)) {
+        return 0;
+    }
+
+    return (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32)
+         | info.ftLastWriteTime.dwLowDateTime;
+}
+
+/**
+ * @brief Publishes the settings read by the watcher thread on the main thread.
+ */
+class ConfigChangedTask : public ReusableTask {
+  protected:
+    virtual void
+    Execute() {
+        if (reloadFailed.exchange(false)) {
+            _WARNING("Failed to reload the config file. Keeping the current settings.");
+        }
+
+        Settings *next = reloadedSettings.exchange(nullptr);
+        if (next) {
+            next->KeepInstalledPatches(SettingsGuard().Get());
+            PublishSettings(next);
+            _MESSAGE("Config file reloaded.");
+        }
+
+        if (watcherStopped.load()) {
+            _ERROR("Stopped watching the config file for changes.");
+        }
+    }
+};
+
+/// @brief The task queued whenever the INI has been read again.
+static ConfigChangedTask changedTask;
+
+/**
+ * @brief Reads the INI file into new settings, if it has changed, and queues
+ *        them to be published on the main thread.
+ */
+static void
+ReadChangedConfig(
+    SKSETaskInterface *tasks
+) {
+    // The notification covers the whole directory, and editors may delete
+    // the file while saving, so only reload on a real change.
+    uint64_t write = GetLastWriteTime(watchPath);
+    if (!write || (write == lastWrite)) {
+        return;
+    }
+
+    // A file which fails to read is tried again on the next change, as the
+    // editor may not have finished saving it.
+    Settings *next = new Settings();
+    if (next->ReloadConfig(watchPath)) {
+        lastWrite = write;
+
+        // Settings the main thread has yet to take are superseded.
+        delete reloadedSettings.exchange(next);
+    } else {
+        delete next;
+        reloadFailed.store(true);
+    }
+
+    changedTask.Queue(tasks);
+}
+
+/**
+ * @brief Reads the INI file again whenever its directory changes.
+ */
+static void
+WatchConfig(
+    HANDLE change,
+    SKSETaskInterface *tasks
+) {
+    while (WaitForSingleObject(change, INFINITE) == WAIT_OBJECT_0) {
+        Sleep(kSettleTime);
+
+        ReadChangedConfig(tasks);
+
+        if (!FindNextChangeNotification(change)) {
+            break;
+        }
+    }
+
+    FindCloseChangeNotification(change);
+    watcherStopped.store(true);
+    changedTask.Queue(tasks);
+}
+
+/**
+ * @brief Starts a background thread which reloads the INI file at the given
+ *        path whenever it changes.
+ * @param path The path of the INI file.
+ * @param tasks The SKSE task interface, or null if it could not be found.
+ */
+void
+StartConfigWatcher(
+    const std::string &path,
+    SKSETaskInterface *tasks
+) {
+    if (!tasks) {
+        _WARNING("Couldn't get the SKSE task interface. The config will not be reloaded.");
+        return;
+    }
+
+    std::string dir = path.substr(0, path.find_last_of("/\\") + 1);
+    HANDLE change = FindFirstChangeNotificationA(
+        dir.c_str(),
+        FALSE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME
+    );
+    if (change == INVALID_HANDLE_VALUE) {
+        _ERROR("Could not watch %s for changes:%u", dir.c_str(), (unsigned)GetLastError());
+        return;
+    }
+
+    watchPath = path;
+    lastWrite = GetLastWriteTime(path);
+    _MESSAGE("Watching %s for changes.", path.c_str());
+    std::thread(WatchConfig, change, tasks).detach();
+}
@@ -0,0 +1,17 @@
+/**
+ * @file ConfigWatcher.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes the watcher which reloads the INI file while the game runs.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_CONFIG_WATCHER_H__
+#define __SKYRIM_UNCAPPER_AE_CONFIG_WATCHER_H__
+
+#include <string>
+
+#include "PluginAPI.h"
+
+void StartConfigWatcher(const std::string &path, SKSETaskInterface *tasks);
+
+#endif /* __SKYRIM_UNCAPPER_AE_CONFIG_WATCHER_H__ */
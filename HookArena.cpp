@@ -0,0 +1,132 @@
+/**
+ * @file HookArena.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the HookArena class.
+ * @bug No known bugs.
+ *
+ * Every patch we install reaches its thunk or slot with a rel32 displacement,
+ * so the arena must sit within 2GB of the entire game image. We search the
+ * address space below the image one region at a time with VirtualQuery,
+ * skipping straight past anything already in use, and take the highest free
+ * spot we find. This is a single walk of the free list near the image, no
+ * matter how many other plugins have already carved it up.
+ */
+
+#include "HookArena.h"
+
+#include <Windows.h>
+
+#include "common/IErrors.h"
+
+/// @brief The furthest the arena may be from the end of the game image. This
+///        is slightly less than the reach of a rel32, to leave room for the
+///        arena itself and the length of the patched instructions.
+static const uintptr_t kArenaReach = 0x7FF00000;
+
+/**
+ * @brief Gets the size of the loaded image of the given module.
+ */
+static size_t
+GetImageSize(
+    void *module
+) {
+    auto dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(module);
+    auto nt = reinterpret_cast<const IMAGE_NT_HEADERS64*>(
+        reinterpret_cast<const uint8_t*>(module) + dos->e_lfanew
+    );
+    return nt->OptionalHeader.SizeOfImage;
+}
+
+/**
+ * @brief Allocates the arena below the given module, within reach of every
+ *        address in its image.
+ * @param size The number of bytes needed. This is rounded up to a page.
+ * @param module The base address of the game image.
+ * @return True if the arena was allocated, false otherwise.
+ */
+bool
+HookArena::Create(
+    size_t size,
+    void *module
+) {
+    ASSERT(!base);
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const uintptr_t granularity = info.dwAllocationGranularity;
+    size = (size + info.dwPageSize - 1) & ~(static_cast<size_t>(info.dwPageSize) - 1);
+
+    uintptr_t image = reinterpret_cast<uintptr_t>(module);
+    uintptr_t image_end = image + GetImageSize(module);
+    uintptr_t lowest = (image_end > kArenaReach) ? image_end - kArenaReach : granularity;
+
+    uintptr_t addr = image;
+    while ((addr > lowest) && (addr - lowest >= size)) {
+        MEMORY_BASIC_INFORMATION mbi;
+        if (!VirtualQuery(reinterpret_cast<void*>(addr - 1), &mbi, sizeof(mbi))) {
+            break;
+        }
+
+        // The region ends at or after addr, so the highest aligned spot below
+        // addr is the best one it can offer.
+        uintptr_t region = reinterpret_cast<uintptr_t>(mbi.BaseAddress);
+        uintptr_t start = (addr - size) & ~(granularity - 1);
+        if ((mbi.State == MEM_FREE) && (start >= region) && (start >= lowest)) {
+            void *mem = VirtualAlloc(
+                reinterpret_cast<void*>(start),
+                size,
+                MEM_RESERVE | MEM_COMMIT,
+                PAGE_EXECUTE_READWRITE
+            );
+
+            if (mem) {
+                base = reinterpret_cast<uintptr_t>(mem);
+                capacity = size;
+                return true;
+            }
+        }
+
+        addr = region;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Takes the given number of bytes from the arena.
+ *
+ * The arena is sized up front from the enabled signatures, so running out of
+ * space is a bug.
+ *
+ * @param size The size of the allocation, which must be at most kSlotAlign.
+ * @return The allocation, which is aligned to kSlotAlign.
+ */
+void *
+HookArena::Allocate(
+    size_t size
+) {
+    ASSERT(base && (size <= kSlotAlign));
+
+    size_t taken = SlotSize(size);
+    ASSERT(taken <= capacity - used);
+
+    void *ret = reinterpret_cast<void*>(base + used);
+    used += taken;
+    slots++;
+    return ret;
+}
+
+/**
+ * @brief Logs how much of the arena was used.
+ */
+void
+HookArena::LogUsage() const {
+    _MESSAGE(
+        "Hook arena at %p holds %zu slots in %zu of %zu bytes (%.1f%%).",
+        reinterpret_cast<void*>(base),
+        slots,
+        used,
+        capacity,
+        capacity ? (100.0 * used / capacity) : 0.0
+    );
+}
@@ -0,0 +1,55 @@
+/**
+ * @file HookArena.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes the executable memory which holds our hook thunks and slots.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_HOOK_ARENA_H__
+#define __SKYRIM_UNCAPPER_AE_HOOK_ARENA_H__
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A single block of executable memory within rel32 reach of the game,
+ *        which every hook thunk and address slot is packed into.
+ *
+ * The block is found and allocated once, with a single VirtualAlloc, rather
+ * than going through the SKSE branch trampoline. Allocations are packed in the
+ * order they are made, each aligned to kSlotAlign bytes. No slot is larger
+ * than that, so none of them ever straddle a cache line.
+ */
+class HookArena {
+  public:
+    /// @brief The alignment and maximum size of a single allocation.
+    static constexpr size_t kSlotAlign = 16;
+
+    /**
+     * @brief Gets the arena space taken by an allocation of the given size.
+     */
+    static constexpr size_t
+    SlotSize(
+        size_t size
+    ) {
+        return (size + kSlotAlign - 1) & ~(kSlotAlign - 1);
+    }
+
+  private:
+    uintptr_t base;
+    size_t capacity;
+    size_t used;
+    size_t slots;
+
+  public:
+    HookArena() : base(0), capacity(0), used(0), slots(0) {}
+
+    bool Create(size_t size, void *module);
+    void *Allocate(size_t size);
+    void LogUsage(void) const;
+
+    /// @brief Gets the start of the arena.
+    inline uintptr_t Base() const { return base; }
+};
+
+#endif /* __SKYRIM_UNCAPPER_AE_HOOK_ARENA_H__ */
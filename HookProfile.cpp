@@ -0,0 +1,210 @@
+/**
+ * @file HookProfile.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the hook profiling counters.
+ * @bug No known bugs.
+ *
+ * Each thread which enters a profiled hook gets its own block of counters, so
+ * the hooks never contend on a shared cache line. The blocks are linked into a
+ * global list when they are created and are never freed, which lets the dump
+ * sum them without any locking. Note that a thread only ever writes its own
+ * block, so the increments need not be atomic read-modify-writes.
+ */
+
+#include "HookProfile.h"
+
+const char *const HookProfile::kHookNames[kCount] = {
+    "GetSkillCap",
+    "CalculateChargePointsPerUse",
+    "PlayerAVOGetCurrent",
+    "ImprovePlayerSkillPoints",
+    "ModifyPerkPool",
+    "ImproveLevelExpBySkillLevel",
+    "ImproveAttributeWhenLevelUp",
+    "LegendaryResetSkillLevel",
+    "CheckConditionForLegendarySkill",
+    "HideLegendaryButton"
+};
+
+/**
+ * @brief Converts the given hook to a string.
+ *
+ * The returned string must not be freed.
+ */
+const char *
+HookProfile::Str(
+    t hook
+) {
+    ASSERT(hook < kCount);
+    return kHookNames[hook];
+}
+
+#ifdef SKYRIM_UNCAPPER_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "ReusableTask.h"
+
+/// @brief The counters of a single thread.
+struct ThreadHookCounters {
+    std::atomic<uint64_t> calls[HookProfile::kCount];
+    std::atomic<uint64_t> cycles[HookProfile::kCount];
+    std::atomic<uint64_t> buckets[HookProfile::kCount][HookProfile::kBuckets];
+    ThreadHookCounters *next;
+};
+
+/// @brief Every block of counters which has been created.
+static std::atomic<ThreadHookCounters*> allCounters;
+
+/// @brief The counters of the current thread.
+static thread_local ThreadHookCounters *threadCounters;
+
+/**
+ * @brief Gets the counters of the current thread, creating them if necessary.
+ */
+static ThreadHookCounters *
+GetThreadCounters() {
+    ThreadHookCounters *counters = threadCounters;
+    if (!counters) {
+        counters = new ThreadHookCounters();
+        counters->next = allCounters.load(std::memory_order_relaxed);
+        while (!allCounters.compare_exchange_weak(counters->next, counters,
+                std::memory_order_release, std::memory_order_relaxed));
+        threadCounters = counters;
+    }
+    return counters;
+}
+
+/**
+ * @brief Adds to a counter which is only ever written by this thread.
+ */
+static inline void
+Bump(
+    std::atomic<uint64_t> &counter,
+    uint64_t val
+) {
+    counter.store(counter.load(std::memory_order_relaxed) + val,
+                  std::memory_order_relaxed);
+}
+
+/**
+ * @brief Records a single call to the given hook.
+ * @param hook The hook which was called.
+ * @param cycles The number of cycles the call took.
+ */
+void
+HookProfile::Record(
+    t hook,
+    uint64_t cycles
+) {
+    ThreadHookCounters *counters = GetThreadCounters();
+
+    unsigned long bucket;
+    _BitScanReverse64(&bucket, cycles | 1);
+
+    Bump(counters->calls[hook], 1);
+    Bump(counters->cycles[hook], cycles);
+    Bump(counters->buckets[hook][bucket], 1);
+}
+
+/**
+ * @brief Finds the upper bound of the bucket containing the given fraction
+ *        of calls.
+ */
+static uint64_t
+GetPercentile(
+    const uint64_t (&buckets)[HookProfile::kBuckets],
+    uint64_t calls,
+    double fraction
+) {
+    uint64_t target = static_cast<uint64_t>(calls * fraction);
+    uint64_t acc = 0;
+    for (unsigned int i = 0; i < HookProfile::kBuckets; i++) {
+        acc += buckets[i];
+        if (acc > target) {
+            return (i + 1 < 64) ? (1ULL << (i + 1)) : UINT64_MAX;
+        }
+    }
+    return UINT64_MAX;
+}
+
+/**
+ * @brief Writes the totals of every thread to the log.
+ */
+void
+HookProfile::Dump() {
+    uint64_t calls[kCount] = { 0 };
+    uint64_t cycles[kCount] = { 0 };
+    uint64_t buckets[kCount][kBuckets] = { 0 };
+
+    for (ThreadHookCounters *counters = allCounters.load(std::memory_order_acquire);
+            counters; counters = counters->next) {
+        for (int i = 0; i < kCount; i++) {
+            calls[i] += counters->calls[i].load(std::memory_order_relaxed);
+            cycles[i] += counters->cycles[i].load(std::memory_order_relaxed);
+            for (unsigned int j = 0; j < kBuckets; j++) {
+                buckets[i][j] += counters->buckets[i][j].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    _MESSAGE("Hook profile (cycles, percentiles are bucket upper bounds):");
+    for (int i = 0; i < kCount; i++) {
+        if (!calls[i]) {
+            continue;
+        }
+
+        _MESSAGE(
+            "  %-32s calls: %llu mean: %llu p50: %llu p99: %llu",
+            Str(static_cast<t>(i)),
+            calls[i],
+            cycles[i] / calls[i],
+            GetPercentile(buckets[i], calls[i], 0.50),
+            GetPercentile(buckets[i], calls[i], 0.99)
+        );
+    }
+}
+
+/**
+ * @brief Dumps the profile on the main thread.
+ *
+ * The log isn't synchronized, so the dump thread only queues this task.
+ */
+class HookProfileDumpTask : public ReusableTask {
+  protected:
+    virtual void
+    Execute() {
+        HookProfile::Dump();
+    }
+};
+
+/// @brief The task queued to dump the profile.
+static HookProfileDumpTask dumpTask;
+
+/**
+ * @brief Starts a background thread which has the main thread dump the
+ *        profile to the log at the given period.
+ * @param period_ms The time between dumps.
+ * @param tasks The SKSE task interface, or null if it could not be found.
+ */
+void
+HookProfile::StartPeriodicDump(
+    unsigned int period_ms,
+    SKSETaskInterface *tasks
+) {
+    if (!tasks) {
+        _WARNING("Couldn't get the SKSE task interface. The hook profile will not be dumped.");
+        return;
+    }
+
+    std::thread([period_ms, tasks]() {
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(period_ms));
+            dumpTask.Queue(tasks);
+        }
+    }).detach();
+}
+
+#endif /* SKYRIM_UNCAPPER_PROFILE */
@@ -0,0 +1,89 @@
+/**
+ * @file HookProfile.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Optional call counters and latency histograms for our hooks.
+ * @bug No known bugs.
+ *
+ * Profiling is only compiled in when SKYRIM_UNCAPPER_PROFILE is defined by the
+ * build. Otherwise, PROFILE_HOOK() expands to nothing and the hooks carry no
+ * extra cost.
+ *
+ * Note that only the C++ hook bodies are measured. The assembly wrappers
+ * around some of them are not.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_HOOK_PROFILE_H__
+#define __SKYRIM_UNCAPPER_AE_HOOK_PROFILE_H__
+
+#include <cstdint>
+
+#ifdef SKYRIM_UNCAPPER_PROFILE
+#include <intrin.h>
+
+#include "PluginAPI.h"
+#endif
+
+/**
+ * @brief Encodes each of the hooks which can be profiled.
+ */
+class HookProfile {
+  public:
+    enum t {
+        GetSkillCap,
+        CalculateChargePointsPerUse,
+        PlayerAVOGetCurrent,
+        ImprovePlayerSkillPoints,
+        ModifyPerkPool,
+        ImproveLevelExpBySkillLevel,
+        ImproveAttributeWhenLevelUp,
+        LegendaryResetSkillLevel,
+        CheckConditionForLegendarySkill,
+        HideLegendaryButton,
+        kCount
+    };
+
+    /// @brief The number of log2 latency buckets kept for each hook.
+    static const unsigned int kBuckets = 64;
+
+  private:
+    /// @brief Used to convert a hook enum to a hook name.
+    static const char *const kHookNames[kCount];
+
+  public:
+    static const char *Str(t hook);
+
+#ifdef SKYRIM_UNCAPPER_PROFILE
+    static void Record(t hook, uint64_t cycles);
+    static void Dump(void);
+    static void StartPeriodicDump(unsigned int period_ms, SKSETaskInterface *tasks);
+#endif
+};
+
+#ifdef SKYRIM_UNCAPPER_PROFILE
+/**
+ * @brief Records the number of cycles spent in the enclosing scope.
+ */
+class HookProfileScope {
+  private:
+    HookProfile::t hook;
+    uint64_t start;
+
+  public:
+    explicit HookProfileScope(
+        HookProfile::t hook
+    ) : hook(hook),
+        start(__rdtsc())
+    {}
+
+    ~HookProfileScope() {
+        HookProfile::Record(hook, __rdtsc() - start);
+    }
+};
+
+/// @brief Profiles the rest of the enclosing scope as the given hook.
+#define PROFILE_HOOK(hook) HookProfileScope hook_profile_scope(HookProfile::hook)
+#else
+#define PROFILE_HOOK(hook)
+#endif
+
+#endif /* __SKYRIM_UNCAPPER_AE_HOOK_PROFILE_H__ */
@@ -0,0 +1,144 @@
+/**
+ * @file HookTrace.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the hook trace capture.
+ * @bug No known bugs.
+ *
+ * Unlike the profile counters, a trace must keep the order of the calls made
+ * across every thread, so the records share a single buffer behind a lock.
+ * This makes the traced hooks slower, which is fine since a capture build is
+ * only used to record input for the benchmark, never to measure the game.
+ */
+
+#include "HookTrace.h"
+
+#ifdef SKYRIM_UNCAPPER_TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Compare.h"
+
+/// @brief The number of buffered records which causes a write to the file.
+static const size_t kFlushRecords = 4096;
+
+/// @brief Protects the trace file and buffer.
+static std::mutex traceLock;
+
+/// @brief The open trace file, or null if tracing is not active.
+static FILE *traceFile;
+
+/// @brief Records which have not yet been written to the trace file.
+static std::vector<HookTraceRecord> traceBuffer;
+
+/**
+ * @brief Writes the buffered records to the trace file.
+ *
+ * The trace lock must be held by the caller.
+ */
+static void
+FlushLocked() {
+    if (traceFile && !traceBuffer.empty()) {
+        fwrite(traceBuffer.data(), sizeof(HookTraceRecord), traceBuffer.size(), traceFile);
+        fflush(traceFile);
+    }
+    traceBuffer.clear();
+}
+
+/**
+ * @brief Creates the trace file at the given path and starts recording.
+ * @return True if the file could be created, false otherwise.
+ */
+bool
+HookTrace::Open(
+    const std::string &path
+) {
+    std::lock_guard<std::mutex> lock(traceLock);
+    ASSERT(!traceFile);
+
+    if (fopen_s(&traceFile, path.c_str(), "wb") || !traceFile) {
+        _ERROR("Failed to create the hook trace %s.", path.c_str());
+        traceFile = nullptr;
+        return false;
+    }
+
+    HookTraceHeader header = {
+        HOOK_TRACE_MAGIC,
+        HOOK_TRACE_VERSION,
+        sizeof(HookTraceRecord),
+        0
+    };
+    fwrite(&header, sizeof(header), 1, traceFile);
+
+    traceBuffer.reserve(kFlushRecords);
+    _MESSAGE("Recording hook calls to %s.", path.c_str());
+    return true;
+}
+
+/**
+ * @brief Records a single call to the given hook.
+ * @param hook The hook which was called.
+ * @param attr The attribute the hook was called with.
+ * @param val The value the hook received. See HookTraceRecord.
+ * @param skill_level The base level of the skill, if any.
+ * @param player_level The level of the player, if used by the hook.
+ */
+void
+HookTrace::Record(
+    HookProfile::t hook,
+    ActorAttribute::t attr,
+    float val,
+    float skill_level,
+    unsigned int player_level
+) {
+    HookTraceRecord record = {
+        static_cast<uint8_t>(hook),
+        static_cast<uint8_t>(attr),
+        static_cast<uint16_t>(MIN(player_level, 0xFFFFU)),
+        val,
+        skill_level
+    };
+
+    std::lock_guard<std::mutex> lock(traceLock);
+    if (!traceFile) {
+        return;
+    }
+
+    traceBuffer.push_back(record);
+    if (traceBuffer.size() >= kFlushRecords) {
+        FlushLocked();
+    }
+}
+
+/**
+ * @brief Writes every buffered record to the trace file.
+ */
+void
+HookTrace::Flush() {
+    std::lock_guard<std::mutex> lock(traceLock);
+    FlushLocked();
+}
+
+/**
+ * @brief Starts a background thread which writes the buffered records to the
+ *        trace file at the given period.
+ *
+ * The game is usually closed without unloading us, so this keeps the trace
+ * from losing more than one period of calls.
+ */
+void
+HookTrace::StartPeriodicFlush(
+    unsigned int period_ms
+) {
+    std::thread([period_ms]() {
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(period_ms));
+            Flush();
+        }
+    }).detach();
+}
+
+#endif /* SKYRIM_UNCAPPER_TRACE */
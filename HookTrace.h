@@ -0,0 +1,78 @@
+/**
+ * @file HookTrace.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Optional capture of the arguments our hottest hooks receive.
+ * @bug No known bugs.
+ *
+ * Tracing is only compiled in when SKYRIM_UNCAPPER_TRACE is defined by the
+ * build. Otherwise, TRACE_HOOK() expands to nothing and the hooks carry no
+ * extra cost.
+ *
+ * A trace file is a HookTraceHeader followed by a flat array of
+ * HookTraceRecord structures, in the order the calls were made. The
+ * benchmark in bench/ can replay a trace through the hook bodies.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_HOOK_TRACE_H__
+#define __SKYRIM_UNCAPPER_AE_HOOK_TRACE_H__
+
+#include <cstdint>
+#include <string>
+
+#include "ActorAttribute.h"
+#include "HookProfile.h"
+
+/// @brief The magic number at the start of every trace file ("SUTR").
+#define HOOK_TRACE_MAGIC 0x52545553
+
+/// @brief The version of the trace file format.
+#define HOOK_TRACE_VERSION 1
+
+/**
+ * @brief The header at the start of a trace file.
+ */
+struct HookTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+/**
+ * @brief A single traced hook call.
+ *
+ * For ImprovePlayerSkillPoints, val is the exp passed to the hook. For
+ * PlayerAVOGetCurrent, val is the value returned by the original function and
+ * the levels are unused.
+ */
+struct HookTraceRecord {
+    uint8_t hook;
+    uint8_t attr;
+    uint16_t player_level;
+    float val;
+    float skill_level;
+};
+
+static_assert(sizeof(HookTraceRecord) == 12, "Trace records must stay compact");
+
+#ifdef SKYRIM_UNCAPPER_TRACE
+/**
+ * @brief Collects traced calls and writes them out to the trace file.
+ */
+class HookTrace {
+  public:
+    static bool Open(const std::string &path);
+    static void Record(HookProfile::t hook, ActorAttribute::t attr, float val,
+                       float skill_level, unsigned int player_level);
+    static void Flush(void);
+    static void StartPeriodicFlush(unsigned int period_ms);
+};
+
+/// @brief Records a call to the given hook in the trace.
+#define TRACE_HOOK(hook, attr, val, skill_level, player_level) \
+    HookTrace::Record(HookProfile::hook, (attr), (val), (skill_level), (player_level))
+#else
+#define TRACE_HOOK(hook, attr, val, skill_level, player_level)
+#endif
+
+#endif /* __SKYRIM_UNCAPPER_AE_HOOK_TRACE_H__ */
@@ -13,7 +13,8 @@
 .CODE
 
 EXTERN GetSkillCap_Hook:PROC
-EXTERN CalculateChargePointsPerUse_Hook:PROC
+EXTERN SkillCapTable:REAL4
+EXTERN CalculateChargePointsPerUse_HookTarget:PTR
 EXTERN PlayerAVOGetCurrent_ReturnTrampoline:PTR
 EXTERN DisplayTrueSkillLevel_ReturnTrampoline:PTR
 
@@ -74,9 +75,32 @@ RESTOREALL MACRO
     pop rax
 ENDM
 
-; This function gets injected in the middle of another, so we must use the call
-; injection macros to protect the register state.
+; The range of skill IDs covered by SkillCapTable. Must match ActorAttribute.h
+; and SkillSlot.h, which static assert as much in Settings.cpp.
+SKILL_ID_FIRST EQU 6
+SKILL_ID_COUNT EQU 18
+
+; This function gets injected in the middle of another, so we must protect the
+; register state. This runs on every skill-increase check, so skills are served
+; straight from SkillCapTable, which only needs rax and rcx. Anything else goes
+; through the C++ hook with the call injection macros. We don't know what the
+; game code around us still uses, so rax and the flags are saved on both paths.
+; The two pushes keep the stack alignment of the slow path's call.
 SkillCapPatch_Wrapper PROC PUBLIC
+    pushfq
+    push rax
+    mov eax, esi ; SkillID, zero extended.
+    sub eax, SKILL_ID_FIRST
+    cmp eax, SKILL_ID_COUNT
+    jae SkillCapPatch_Wrapper_Slow ; Unsigned, so this also catches IDs below.
+    push rcx
+    lea rcx, SkillCapTable
+    movss xmm10, dword ptr [rcx + rax * 4] ; Replace maximum with the cap.
+    pop rcx
+    pop rax
+    popfq
+    ret
+SkillCapPatch_Wrapper_Slow:
     BEGIN_INJECTED_CALL
     mov ecx, esi ; pass SkillID in ecx to hook.
     sub rsp, 20h ; Required by calling convention to alloc this.
@@ -84,19 +108,22 @@ SkillCapPatch_Wrapper PROC PUBLIC
     add rsp, 20h
     movss xmm10, xmm0 ; Replace maximum with fn result.
     END_INJECTED_CALL
+    pop rax
+    popfq
     ret
 SkillCapPatch_Wrapper ENDP
 
 ; Wraps our CalculateChargePointsPerUse function. We use this wrapper to get
 ; access to the maxCharge argument that our caller gets, which is its 5th 
 ; argument (rsp + a0). We replace the call to the original function, so no
-; reg save. We're just adding an arg.
+; reg save. We're just adding an arg. The hook is reached through a pointer,
+; as the patcher picks which specialization of it to use.
 CalculateChargePointsPerUse_Wrapper PROC PUBLIC
     movss xmm2, dword ptr [rsp + 0a8h] ; Get max_charge.
     movaps xmm1, xmm7 ; Get base_points
     xorps xmm3, xmm3 ; Reimplement max from original code.
     maxss xmm2, xmm3
-    jmp CalculateChargePointsPerUse_Hook
+    jmp CalculateChargePointsPerUse_HookTarget
 CalculateChargePointsPerUse_Wrapper ENDP
 
 ; This function allows us to call the OG PlayerAVOGetCurrent function by
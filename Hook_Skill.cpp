@@ -15,7 +15,10 @@
 #include "GameReferences.h"
 #include "GameSettings.h"
 
+#include "HookProfile.h"
+#include "HookTrace.h"
 #include "HookWrappers.h"
+#include "PlayerCache.h"
 #include "Settings.h"
 #include "RelocFn.h"
 #include "Compare.h"
@@ -23,13 +26,18 @@
 
 /**
  * @brief Determines the real skill cap of the given skill.
+ *
+ * As with the other hot hooks, the enable flag is not checked here. The hook
+ * is only installed when it is set, and Settings::KeepInstalledPatches()
+ * stops a reload from clearing it.
  */
 extern "C" float
 GetSkillCap_Hook(
     ActorAttribute::t skill
 ) {
-    ASSERT(settings.IsSkillCapEnabled());
-    return settings.GetSkillCap(skill);
+    PROFILE_HOOK(GetSkillCap);
+    SettingsGuard guard;
+    return guard.Get().GetSkillCap(skill);
 }
 
 /**
@@ -38,23 +46,31 @@ GetSkillCap_Hook(
  * The original equation would fall apart for levels above 199, so this
  * implementation caps the level in the calculation to 199.
  *
+ * The charge formula can't change without a restart, so the patcher installs
+ * the specialization for the loaded formula and the hook never checks it.
+ *
+ * @tparam kLinear Whether the linear charge formula is in use.
  * @param player_av The actor value owner from the player class.
  * @param base_points The base point value for the enchantment.
  * @param max_charge The maximum charge level of the item.
  * @return The charge points per use on the item.
  */
-extern "C" float
+template <bool kLinear>
+float
 CalculateChargePointsPerUse_Hook(
     void *player_av,
     float base_points,
     float max_charge
 ) {
+    PROFILE_HOOK(CalculateChargePointsPerUse);
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
     ASSERT(settings.IsEnchantPatchEnabled());
 
-    float cost_exponent = *GetFloatGameSetting("fEnchantingCostExponent");
-    float cost_base = *GetFloatGameSetting("fEnchantingSkillCostBase");
-    float cost_scale = *GetFloatGameSetting("fEnchantingSkillCostScale");
-    float cost_mult = *GetFloatGameSetting("fEnchantingSkillCostMult");
+    float cost_exponent = *GetFloatGameSetting(GameSetting::EnchantingCostExponent);
+    float cost_base = *GetFloatGameSetting(GameSetting::EnchantingSkillCostBase);
+    float cost_scale = *GetFloatGameSetting(GameSetting::EnchantingSkillCostScale);
+    float cost_mult = *GetFloatGameSetting(GameSetting::EnchantingSkillCostMult);
     float cap = settings.GetEnchantChargeCap();
     float enchanting_level = MIN(
         PlayerAVOGetCurrent_Original(player_av, ActorAttribute::Enchanting),
@@ -63,7 +79,7 @@ CalculateChargePointsPerUse_Hook(
 
     float base = cost_mult * pow(base_points, cost_exponent);
 
-    if (settings.IsEnchantChargeLinear()) {
+    if constexpr (kLinear) {
         // Linearly scale between the normal min/max of charge points.
         float max_level_scale = pow(cap * cost_base, cost_scale);
         float slope = (max_charge * max_level_scale) / (base * (1.0f - max_level_scale) * cap);
@@ -76,37 +92,49 @@ CalculateChargePointsPerUse_Hook(
     }
 }
 
+template float CalculateChargePointsPerUse_Hook<false>(void *, float, float);
+template float CalculateChargePointsPerUse_Hook<true>(void *, float, float);
+
 /**
  * @brief Caps the formulas for the given skill_id to the value specified in
  *        the INI file.
+ *
+ * This is called for every actor value read of the player, so it only does a
+ * single table lookup. Note that this hook is never called for enchanting
+ * charge calculation; we overwrite the code which would have.
  */
 float
 PlayerAVOGetCurrent_Hook(
     void *av,
     ActorAttribute::t attr
 ) {
-    ASSERT(settings.IsSkillFormulaCapEnabled());
+    PROFILE_HOOK(PlayerAVOGetCurrent);
     // FIXME: Need to find where this is called in the text color code and
     //        replace it so the skills menu is actually correct.
-
     float val = PlayerAVOGetCurrent_Original(av, attr);
+    TRACE_HOOK(PlayerAVOGetCurrent, attr, val, 0, 0);
 
-    if (ActorAttribute::IsSkill(attr)) {
-        val = MAX(0, MIN(val, settings.GetSkillFormulaCap(attr)));
+    SettingsGuard guard;
+    return guard.Get().ClampSkillFormula(attr, val);
+}
 
-        // If this is a call for enchanting, we enforce the magnitude
-        // cap here. Note that this hook is never called for charge
-        // calculation; we overwrite the code which would have.
-        if (attr == ActorAttribute::Enchanting) {
-            val = MIN(val, settings.GetSkillFormulaCap(ActorAttribute::Enchanting));
-        }
-    }
+/// @brief The skill data of the player, as last seen by our exp hook. The game
+///        only keeps one of these, and we have no version independent way of
+///        finding it in the player.
+static PlayerSkills *playerSkills = nullptr;
 
-    return val;
-}
+/// @brief The highest level the game can store for the player.
+static const unsigned int kMaxPlayerLevel = 0xFFFF;
+
+/// @brief Set by ImproveLevelExpBySkillLevel_Hook(), which the game only calls
+///        when a skill levels up, so the exp hook knows to drop the cache.
+static thread_local bool skillLeveledUp = false;
 
 /**
  * @brief Applies a multiplier to the exp gain for the given skill.
+ *
+ * The enable flag is not checked here, for the same reason as in
+ * GetSkillCap_Hook().
  */
 void
 ImprovePlayerSkillPoints_Hook(
@@ -118,17 +146,109 @@ ImprovePlayerSkillPoints_Hook(
     UInt8 unk3,
     bool unk4
 ) {
-    ASSERT(settings.IsSkillExpEnabled());
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
+    playerSkills = skill_data;
 
-    if (ActorAttribute::IsSkill(attr)) {
-        exp *= settings.GetSkillExpGainMult(
-            attr,
-            PlayerAVOGetBase(attr),
-            GetPlayerLevel()
-        );
+    if (!ActorAttribute::IsSkill(attr)) {
+        ImprovePlayerSkillPoints_Original(skill_data, attr, exp, unk1, unk2, unk3, unk4);
+        return;
+    }
+
+    float skill_level;
+    {
+        // The original function is left out of the profile, as it is mostly
+        // game code.
+        PROFILE_HOOK(ImprovePlayerSkillPoints);
+        skill_level = GetCachedPlayerAVOBase(attr);
+        unsigned int player_level = GetCachedPlayerLevel();
+        TRACE_HOOK(ImprovePlayerSkillPoints, attr, exp, skill_level, player_level);
+        exp *= settings.GetSkillExpGainMult(attr, skill_level, player_level);
     }
 
+    skillLeveledUp = false;
     ImprovePlayerSkillPoints_Original(skill_data, attr, exp, unk1, unk2, unk3, unk4);
+
+    // Most awards don't level the skill, and those must keep the cache warm
+    // for the rest of the burst. The level exp hook tells us when one does.
+    // Without it, the skill level must be read back to find out.
+    if (settings.IsLevelExpEnabled()) {
+        if (skillLeveledUp) {
+            InvalidatePlayerCache();
+        }
+    } else if (PlayerAVOGetBase(attr) != skill_level) {
+        InvalidatePlayerCache();
+    }
+}
+
+/**
+ * @brief Gives the player exp in several skills at once, as if each entry had
+ *        been passed to ImprovePlayerSkillPoints_Hook() in turn.
+ *
+ * The multipliers of every skill are computed in one pass, from a single
+ * settings snapshot and the skill levels at the start of the batch. This lets
+ * the entries of each skill be summed and given to the game in one call. As
+ * such, a skill which levels up partway through the batch keeps the
+ * multiplier it started with.
+ *
+ * Must be called from the game's main thread.
+ *
+ * @param awards The skill and exp of each entry.
+ * @param count The number of entries.
+ * @return The number of entries which were applied.
+ */
+size_t
+AwardSkillExpBatch(
+    const SkyrimUncapperSkillExp *awards,
+    size_t count
+) {
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
+
+    // Without our hook, the original function has no trampoline to call.
+    if (!settings.IsSkillExpEnabled() || !playerSkills) {
+        return 0;
+    }
+
+    float exp[SkillSlot::kCount] = {};
+    size_t applied = 0;
+    for (size_t i = 0; i < count; i++) {
+        ActorAttribute::t attr = static_cast<ActorAttribute::t>(awards[i].skill);
+        if (ActorAttribute::IsSkill(attr) && (awards[i].exp > 0.0f)) {
+            exp[SkillSlot::FromAttribute(attr)] += awards[i].exp;
+            applied++;
+        }
+    }
+
+    if (!applied) {
+        return 0;
+    }
+
+    unsigned int skill_levels[SkillSlot::kCount];
+    for (int i = 0; i < SkillSlot::kCount; i++) {
+        ActorAttribute::t attr = SkillSlot::ToAttribute(static_cast<SkillSlot::t>(i));
+        skill_levels[i] = (exp[i] > 0.0f)
+            ? static_cast<unsigned int>(GetCachedPlayerAVOBase(attr))
+            : 0;
+    }
+
+    float mults[SkillSlot::kCount];
+    settings.GetSkillExpGainMults(skill_levels, GetCachedPlayerLevel(), mults);
+
+    for (int i = 0; i < SkillSlot::kCount; i++) {
+        if (exp[i] > 0.0f) {
+            ImprovePlayerSkillPoints_Original(
+                playerSkills,
+                SkillSlot::ToAttribute(static_cast<SkillSlot::t>(i)),
+                exp[i] * mults[i],
+                0, 0, 0, false
+            );
+        }
+    }
+
+    // Any of the skills may have leveled up.
+    InvalidatePlayerCache();
+    return applied;
 }
 
 /**
@@ -143,6 +263,10 @@ ModifyPerkPool_Hook(
     UInt8 points,
     SInt8 count
 ) {
+    PROFILE_HOOK(ModifyPerkPool);
+    InvalidatePlayerCache(); // Points are given on level-up, so the level may be new.
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
     ASSERT(settings.IsPerkPointsEnabled());
     int delta = MIN(0xFF, settings.GetPerkDelta(GetPlayerLevel()));
     int res = points + ((count > 0) ? delta : count);
@@ -160,12 +284,19 @@ ImproveLevelExpBySkillLevel_Hook(
     float exp,
     ActorAttribute::t attr
 ) {
+    PROFILE_HOOK(ImproveLevelExpBySkillLevel);
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
     ASSERT(settings.IsLevelExpEnabled());
     if (ActorAttribute::IsSkill(attr)) {
+        // This is only called when a skill levels up, so the cached skill
+        // level is out of date. It is read from the game instead, and the
+        // exp hook invalidates the cache once the level up is done.
+        skillLeveledUp = true;
         exp *= settings.GetLevelSkillExpMult(
             attr,
             PlayerAVOGetBase(attr),
-            GetPlayerLevel()
+            GetCachedPlayerLevel()
         );
     }
 
@@ -185,7 +316,10 @@ ImproveAttributeWhenLevelUp_Hook(
     void *player_avo,
     ActorAttribute::t choice
 ) {
+    PROFILE_HOOK(ImproveAttributeWhenLevelUp);
     (void)player_avo;
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
     ASSERT(settings.IsAttributePointsEnabled());
     
     ActorAttributeLevelUp level_up;
@@ -195,14 +329,50 @@ ImproveAttributeWhenLevelUp_Hook(
         level_up
     );
 
-    PlayerAVOModBase(ActorAttribute::Health, level_up.health);
-    PlayerAVOModBase(ActorAttribute::Magicka, level_up.magicka);
-    PlayerAVOModBase(ActorAttribute::Stamina, level_up.stamina);
-    PlayerAVOModCurrent(
-        0, // Same as OG call.
-        ActorAttribute::CarryWeight,
-        level_up.carry_weight
-    );
+    PlayerAVOApplyLevelUp(level_up);
+}
+
+/**
+ * @brief Applies the attribute gains of several level ups at once, as if the
+ *        player had made the same choice at each of them.
+ *
+ * This is meant for catching a player up across many levels, and is reached
+ * through kMessage_ApplyAttributeLevelUps. The deltas are summed from the
+ * settings without walking each level, and then applied to the player in a
+ * single pass.
+ *
+ * Must be called from the game's main thread.
+ *
+ * The range comes from other plugins, so it is checked against the highest
+ * level the game can store before any sums are taken.
+ *
+ * @param first_level The level of the first level up.
+ * @param count The number of level ups to apply.
+ * @param choice The attribute the player selected to level.
+ * @return True if the level ups were applied, false if the range or choice is
+ *         invalid or the attribute settings are disabled.
+ */
+bool
+ApplyAttributeLevelUps(
+    unsigned int first_level,
+    size_t count,
+    ActorAttribute::t choice
+) {
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
+    if (!settings.IsAttributePointsEnabled()
+            || (count > kMaxPlayerLevel)
+            || (first_level > (kMaxPlayerLevel - count))
+            || ((choice != ActorAttribute::Health)
+                && (choice != ActorAttribute::Magicka)
+                && (choice != ActorAttribute::Stamina))) {
+        return false;
+    }
+
+    ActorAttributeLevelUp level_up;
+    settings.GetAttributeLevelUpRange(first_level, count, choice, level_up);
+    PlayerAVOApplyLevelUp(level_up);
+    return true;
 }
 
 /**
@@ -212,9 +382,13 @@ extern "C" void
 LegendaryResetSkillLevel_Hook(
     float base_level
 ) {
+    PROFILE_HOOK(LegendaryResetSkillLevel);
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
     ASSERT(settings.IsLegendaryEnabled());
-    float *reset_val = GetFloatGameSetting("fLegendarySkillResetValue");
+    float *reset_val = GetFloatGameSetting(GameSetting::LegendarySkillResetValue);
     *reset_val = settings.GetPostLegendarySkillLevel(*reset_val, base_level);
+    InvalidatePlayerCache();
 }
 
 /**
@@ -225,6 +399,9 @@ CheckConditionForLegendarySkill_Hook(
     void *player_actor,
     ActorAttribute::t skill
 ) {
+    PROFILE_HOOK(CheckConditionForLegendarySkill);
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
     ASSERT(settings.IsLegendaryEnabled());
     float skill_level = PlayerAVOGetBase(skill);
     return settings.IsLegendaryAvailable(skill);
@@ -239,6 +416,9 @@ HideLegendaryButton_Hook(
     void *player_actor,
     ActorAttribute::t skill
 ) {
+    PROFILE_HOOK(HideLegendaryButton);
+    SettingsGuard guard;
+    const Settings &settings = guard.Get();
     ASSERT(settings.IsLegendaryEnabled());
     float skill_level = PlayerAVOGetBase(skill);
     return settings.IsLegendaryButtonVisible(skill_level);
@@ -9,6 +9,10 @@
 
 #include "GameFormComponents.h"
 #include "ActorAttribute.h"
+#include "SkyrimUncapperAPI.h"
+
+template <bool kLinear>
+float CalculateChargePointsPerUse_Hook(void *player_av, float base_points, float max_charge);
 
 float PlayerAVOGetCurrent_Hook(void *av, ActorAttribute::t skill);
 
@@ -22,5 +26,8 @@ void ImprovePlayerSkillPoints_Hook(
     bool unk4
 );
 void ImproveAttributeWhenLevelUp_Hook(void *player_avo, ActorAttribute::t choice);
+bool ApplyAttributeLevelUps(unsigned int first_level, size_t count,
+                            ActorAttribute::t choice);
+size_t AwardSkillExpBatch(const SkyrimUncapperSkillExp *awards, size_t count);
 
 #endif /* __SKYRIM_UNCAPPER_AE_HOOK_SKILL_H__ */
@@ -0,0 +1,385 @@
+/**
+ * @file IniWriter.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the IniWriter class.
+ * @bug No known bugs.
+ *
+ * Saving the config through CSimpleIniA means building the entire file in
+ * memory first, with every key, value, and comment copied into its own
+ * allocation. Our configs can have tens of thousands of entries, so that
+ * made creating and updating them slow. Since the config is always written
+ * out in order, we can instead format each value as it comes and stream it
+ * to the file.
+ *
+ * The output matches CSimpleIniA::SaveFile() byte for byte, so configs look
+ * the same no matter which version of the plugin wrote them.
+ *
+ * Upgrading a config only needs the settings which are new, so the writer can
+ * also merge into an existing file. Everything already in the file is left
+ * exactly as it is, and the cost depends only on how much was added.
+ */
+
+#include "IniWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+/**
+ * @brief Flushes anything left in the buffer and closes the file, if the
+ *        writer was not closed.
+ */
+IniWriter::~IniWriter() {
+    if (file) {
+        Close();
+    }
+}
+
+/**
+ * @brief Creates the INI file at the given path, replacing it if it exists.
+ * @return True if the file could be created, false otherwise.
+ */
+bool
+IniWriter::Open(
+    const std::string &path
+) {
+    ASSERT(!file);
+
+    if (fopen_s(&file, path.c_str(), "wb") || !file) {
+        file = nullptr;
+        return false;
+    }
+
+    buf.resize(kBufSize);
+    len = 0;
+    section.clear();
+    started = false;
+    ok = true;
+    existing = nullptr;
+    needNewline = false;
+    count = 0;
+    return true;
+}
+
+/**
+ * @brief Opens the INI file at the given path to merge new values into it.
+ * @param path The path of the INI file.
+ * @param ini The loaded content of the file. Values it already has are not
+ *            written again. It must outlive the writer.
+ * @return True if the file could be opened, false otherwise.
+ */
+bool
+IniWriter::OpenMerge(
+    const std::string &path,
+    const CSimpleIniA &ini
+) {
+    ASSERT(!file);
+
+    if (fopen_s(&file, path.c_str(), "r+b") || !file) {
+        file = nullptr;
+        return false;
+    }
+
+    // Appended sections must start on their own line.
+    needNewline = !fseek(file, -1, SEEK_END) && (fgetc(file) != '\n');
+    if (fseek(file, 0, SEEK_END)) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    buf.resize(kBufSize);
+    len = 0;
+    section.clear();
+    started = true;
+    ok = true;
+    existing = &ini;
+    count = 0;
+    return true;
+}
+
+/**
+ * @brief Replaces a value in the file being merged into, without moving
+ *        anything else in it.
+ *
+ * The file is only read up to the value, so this is cheap for values near the
+ * top of the file. This must be called before anything is written.
+ *
+ * @param sec The section of the value.
+ * @param key The key of the value.
+ * @param val The new value, which must be as long as the old one.
+ * @return True if the value was replaced, false if it could not be found or
+ *         is a different length. In the latter case, the file is unchanged.
+ */
+bool
+IniWriter::OverwriteValue(
+    const char *sec,
+    const char *key,
+    const char *val
+) {
+    ASSERT(file && existing && !len);
+
+    if (fseek(file, 0, SEEK_SET)) {
+        return false;
+    }
+
+    bool found = false;
+    bool in_section = false;
+    std::string line;
+    while (!found) {
+        long line_start = ftell(file);
+
+        int c;
+        line.clear();
+        while (((c = fgetc(file)) != EOF) && (c != '\n')) {
+            line.push_back(static_cast<char>(c));
+        }
+
+        // Trim the line down to its content.
+        size_t start = 0, end = line.size();
+        while ((start < end) && isspace(static_cast<unsigned char>(line[start]))) { start++; }
+        while ((end > start) && isspace(static_cast<unsigned char>(line[end - 1]))) { end--; }
+
+        if ((start < end) && (line[start] == '[')) {
+            size_t close = line.find(']', start);
+            if (close != std::string::npos) {
+                std::string name = line.substr(start + 1, close - start - 1);
+                in_section = !_stricmp(name.c_str(), sec);
+            }
+        } else if (in_section && (start < end) && (line[start] != ';') && (line[start] != '#')) {
+            size_t eq = line.find('=', start);
+            if (eq != std::string::npos) {
+                size_t key_end = eq;
+                while ((key_end > start) && isspace(static_cast<unsigned char>(line[key_end - 1]))) { key_end--; }
+                size_t val_start = eq + 1;
+                while ((val_start < end) && isspace(static_cast<unsigned char>(line[val_start]))) { val_start++; }
+
+                if (!_stricmp(line.substr(start, key_end - start).c_str(), key)) {
+                    found = true;
+                    if ((end - val_start) != strlen(val)) {
+                        fseek(file, 0, SEEK_END);
+                        return false;
+                    }
+
+                    ok = !fseek(file, line_start + static_cast<long>(val_start), SEEK_SET)
+                        && (fwrite(val, 1, end - val_start, file) == end - val_start)
+                        && ok;
+                }
+            }
+        }
+
+        if (c == EOF) {
+            break;
+        }
+    }
+
+    fseek(file, 0, SEEK_END);
+    return found && ok;
+}
+
+/**
+ * @brief Writes out the rest of the file and closes it.
+ * @return True if every value was written, false otherwise.
+ */
+bool
+IniWriter::Close() {
+    ASSERT(file);
+
+    Flush();
+    ok = !fclose(file) && ok;
+    file = nullptr;
+    existing = nullptr;
+    return ok;
+}
+
+/**
+ * @brief Checks if the given value must not be written, because the file
+ *        being merged into already has it.
+ */
+bool
+IniWriter::Skip(
+    const char *sec,
+    const char *key
+) const {
+    return existing && existing->GetValue(sec, key);
+}
+
+/**
+ * @brief Checks if the file being merged into already has the given section.
+ *
+ * Always false when the file is not being merged into.
+ */
+bool
+IniWriter::HasSection(
+    const char *sec
+) const {
+    return existing && existing->GetSection(sec);
+}
+
+/**
+ * @brief Writes the content of the buffer to the file.
+ */
+void
+IniWriter::Flush() {
+    if (ok && len && (fwrite(buf.data(), 1, len, file) != len)) {
+        ok = false;
+    }
+    len = 0;
+}
+
+/**
+ * @brief Appends the given bytes to the buffer, flushing it as it fills.
+ */
+void
+IniWriter::Put(
+    const char *data,
+    size_t size
+) {
+    while (size) {
+        if (len == buf.size()) {
+            Flush();
+        }
+
+        size_t n = (std::min)(size, buf.size() - len);
+        memcpy(buf.data() + len, data, n);
+        len += n;
+        data += n;
+        size -= n;
+    }
+}
+
+/**
+ * @brief Appends each line of the given text, ending each with a newline.
+ *
+ * As with SimpleIni, a trailing newline in the text is written as an empty
+ * line.
+ */
+void
+IniWriter::PutLines(
+    const char *text
+) {
+    while (true) {
+        const char *end = strchr(text, '\n');
+        if (!end) {
+            end = text + strlen(text);
+        }
+
+        Put(text, end - text);
+        Put(SI_NEWLINE_A);
+
+        if (!*end) {
+            return;
+        }
+        text = end + 1;
+    }
+}
+
+/**
+ * @brief Starts the line of a value, along with its section and comment if
+ *        needed.
+ */
+void
+IniWriter::BeginValue(
+    const char *sec,
+    const char *key,
+    const char *comment
+) {
+    ASSERT(file);
+
+    if (!started || (section != sec)) {
+        if (needNewline) {
+            Put(SI_NEWLINE_A);
+            needNewline = false;
+        }
+        if (started) {
+            Put(SI_NEWLINE_A SI_NEWLINE_A);
+        }
+        Put("[");
+        Put(sec);
+        Put("]" SI_NEWLINE_A);
+        section = sec;
+        started = true;
+    }
+
+    if (comment && *comment) {
+        Put(SI_NEWLINE_A);
+        PutLines(comment);
+    }
+
+    Put(key);
+    Put(" = ");
+    count++;
+}
+
+/**
+ * @brief Writes a value to the given section of the file.
+ * @param sec The section to write the value in.
+ * @param key The key of the value.
+ * @param val The value to write.
+ * @param comment The comment to place above the value, or null.
+ */
+///@{
+void
+IniWriter::Write(
+    const char *sec,
+    const char *key,
+    const char *val,
+    const char *comment
+) {
+    if (Skip(sec, key)) { return; }
+
+    BeginValue(sec, key, comment);
+    Put(val);
+    Put(SI_NEWLINE_A);
+}
+
+void
+IniWriter::Write(
+    const char *sec,
+    const char *key,
+    float val,
+    const char *comment
+) {
+    if (Skip(sec, key)) { return; }
+
+    // SimpleIni formats floats with %f.
+    char num[64];
+    auto res = std::to_chars(num, num + sizeof(num), static_cast<double>(val),
+                             std::chars_format::fixed, 6);
+    ASSERT(res.ec == std::errc());
+
+    BeginValue(sec, key, comment);
+    Put(num, res.ptr - num);
+    Put(SI_NEWLINE_A);
+}
+
+void
+IniWriter::Write(
+    const char *sec,
+    const char *key,
+    unsigned int val,
+    const char *comment
+) {
+    if (Skip(sec, key)) { return; }
+
+    // SimpleIni formats integers as a long, which is what they are read back
+    // as.
+    char num[16];
+    auto res = std::to_chars(num, num + sizeof(num), static_cast<long>(val));
+    ASSERT(res.ec == std::errc());
+
+    BeginValue(sec, key, comment);
+    Put(num, res.ptr - num);
+    Put(SI_NEWLINE_A);
+}
+
+void
+IniWriter::Write(
+    const char *sec,
+    const char *key,
+    bool val,
+    const char *comment
+) {
+    Write(sec, key, val ? "true" : "false", comment);
+}
+///@}
@@ -0,0 +1,87 @@
+/**
+ * @file IniWriter.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes a writer which streams an INI file straight to disk.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_INI_WRITER_H__
+#define __SKYRIM_UNCAPPER_AE_INI_WRITER_H__
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "simpleini/SimpleIni.h"
+
+/**
+ * @brief Writes an INI file one value at a time, in the same format as
+ *        CSimpleIniA::SaveFile().
+ *
+ * Values are formatted into a fixed buffer, which is only flushed to the file
+ * when it fills up. Nothing is kept once it has been written, so the values
+ * of each section must be written together. A new section is started
+ * whenever a value is written to a different section than the last one.
+ *
+ * When merging into an existing file with OpenMerge(), only the values which
+ * the file is missing are written, and they are appended to the end of it.
+ * Sections are reopened there as needed, which SimpleIni merges back together
+ * when the file is loaded. Callers whose sections only make sense as a whole
+ * may check HasSection() and leave an existing section out entirely.
+ *
+ * Once a write fails, every later write is dropped and Close() fails.
+ */
+class IniWriter {
+  private:
+    /// @brief The size of the output buffer.
+    static const size_t kBufSize = 64 * 1024;
+
+    FILE *file;
+    std::vector<char> buf;
+    size_t len;
+    std::string section;
+    bool started;
+    bool ok;
+    const CSimpleIniA *existing;
+    bool needNewline;
+    size_t count;
+
+    void Flush(void);
+    bool Skip(const char *sec, const char *key) const;
+    void Put(const char *data, size_t size);
+    void PutLines(const char *text);
+    void BeginValue(const char *sec, const char *key, const char *comment);
+
+    /// @brief Appends a null terminated string to the buffer.
+    inline void Put(const char *str) { Put(str, strlen(str)); }
+
+  public:
+    IniWriter(
+    ) : file(nullptr),
+        len(0),
+        started(false),
+        ok(false),
+        existing(nullptr),
+        needNewline(false),
+        count(0)
+    {}
+    ~IniWriter();
+
+    bool Open(const std::string &path);
+    bool OpenMerge(const std::string &path, const CSimpleIniA &ini);
+    bool OverwriteValue(const char *sec, const char *key, const char *val);
+    bool Close(void);
+    bool HasSection(const char *sec) const;
+
+    /// @brief Gets the number of values which have been written.
+    inline size_t Count() const { return count; }
+
+    void Write(const char *sec, const char *key, const char *val, const char *comment);
+    void Write(const char *sec, const char *key, float val, const char *comment);
+    void Write(const char *sec, const char *key, unsigned int val, const char *comment);
+    void Write(const char *sec, const char *key, bool val, const char *comment);
+};
+
+#endif /* __SKYRIM_UNCAPPER_AE_INI_WRITER_H__ */
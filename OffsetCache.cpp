@@ -0,0 +1,104 @@
+/**
+ * @file OffsetCache.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Reads and writes the resolved signature offset cache.
+ * @bug No known bugs.
+ *
+ * The cache is a header holding the key it was created with, followed by one
+ * 64-bit offset per signature. Any mismatch causes the caller to fall back to
+ * the address library.
+ */
+
+#include "OffsetCache.h"
+
+#include <cstring>
+#include <vector>
+
+#include "CacheFile.h"
+
+/// @brief Identifies a signature offset cache file ("UOFS").
+static const uint32_t kOffsetCacheMagic = 0x53464F55;
+
+/// @brief Must be incremented whenever the layout of the file changes.
+static const uint32_t kOffsetCacheFormat = 1;
+
+/// @brief The header at the start of the cache.
+struct OffsetCacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    OffsetCacheKey key;
+    uint64_t count;
+};
+
+/**
+ * @brief Reads the offsets which were cached with the given key.
+ * @param path The path of the cache file.
+ * @param key The key the offsets must have been cached with.
+ * @param offsets Returns the cached offsets.
+ * @param count The number of offsets to read.
+ * @return True if the offsets were read, false if the cache could not be used.
+ */
+bool
+ReadOffsetCache(
+    const std::string &path,
+    const OffsetCacheKey &key,
+    uintptr_t *offsets,
+    size_t count
+) {
+    const size_t expected = sizeof(OffsetCacheHeader) + count * sizeof(uint64_t);
+    std::vector<unsigned char> buf;
+    if (!ReadCacheFile(path, expected, buf) || (buf.size() != expected)) {
+        return false;
+    }
+
+    OffsetCacheHeader header;
+    if (!ReadCacheHeader(buf, kOffsetCacheMagic, kOffsetCacheFormat, header)
+            || (header.key.runtime_version != key.runtime_version)
+            || (header.key.db_size != key.db_size)
+            || (header.key.db_mtime != key.db_mtime)
+            || (header.key.sig_hash != key.sig_hash)
+            || (header.count != count)) {
+        return false;
+    }
+
+    const unsigned char *data = buf.data() + sizeof(header);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t offset;
+        memcpy(&offset, data + i * sizeof(offset), sizeof(offset));
+        offsets[i] = static_cast<uintptr_t>(offset);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes the given offsets to the cache with the given key.
+ * @param path The path of the cache file.
+ * @param key The key to store the offsets with.
+ * @param offsets The offsets to be cached.
+ * @param count The number of offsets.
+ * @return True if the cache was written, false otherwise.
+ */
+bool
+WriteOffsetCache(
+    const std::string &path,
+    const OffsetCacheKey &key,
+    const uintptr_t *offsets,
+    size_t count
+) {
+    auto header = MakeCacheHeader<OffsetCacheHeader>(kOffsetCacheMagic, kOffsetCacheFormat);
+    header.key.runtime_version = key.runtime_version;
+    header.key.db_size = key.db_size;
+    header.key.db_mtime = key.db_mtime;
+    header.key.sig_hash = key.sig_hash;
+    header.count = count;
+
+    std::vector<uint64_t> body(offsets, offsets + count);
+    return WriteCacheFile(
+        path,
+        &header,
+        sizeof(header),
+        body.data(),
+        body.size() * sizeof(uint64_t)
+    );
+}
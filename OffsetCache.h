@@ -0,0 +1,54 @@
+/**
+ * @file OffsetCache.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes the cache which stores resolved signature offsets between
+ *        launches of the game.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_OFFSET_CACHE_H__
+#define __SKYRIM_UNCAPPER_AE_OFFSET_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Identifies the inputs a set of cached offsets was resolved from.
+ *
+ * If any of these change, the cached offsets must not be used.
+ */
+struct OffsetCacheKey {
+    uint32_t runtime_version;
+    uint64_t db_size;
+    uint64_t db_mtime;
+    uint64_t sig_hash;
+};
+
+/// @brief The starting value of an FNV-1a hash.
+static const uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+
+/**
+ * @brief Folds a value into a 64-bit FNV-1a hash.
+ * @param hash The hash so far. Start with kFnvOffsetBasis.
+ * @param val The value to add to the hash.
+ * @return The updated hash.
+ */
+constexpr uint64_t
+HashOffsetCacheValue(
+    uint64_t hash,
+    uint64_t val
+) {
+    for (size_t i = 0; i < sizeof(val); i++) {
+        hash ^= (val >> (i * 8)) & 0xFF;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool ReadOffsetCache(const std::string &path, const OffsetCacheKey &key,
+                     uintptr_t *offsets, size_t count);
+bool WriteOffsetCache(const std::string &path, const OffsetCacheKey &key,
+                      const uintptr_t *offsets, size_t count);
+
+#endif /* __SKYRIM_UNCAPPER_AE_OFFSET_CACHE_H__ */
@@ -0,0 +1,180 @@
+/**
+ * @file PatchTransaction.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the PatchTransaction class.
+ * @bug No known bugs.
+ *
+ * Writing each patch with its own SafeWrite call costs two VirtualProtect
+ * calls per write, and leaves the game code half patched for the entire
+ * time it takes to go through every signature. Instead, we queue up every
+ * write and then apply them together, with each page being unprotected
+ * and restored exactly once.
+ */
+
+#include "PatchTransaction.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <Windows.h>
+
+#include "common/IErrors.h"
+
+/**
+ * @brief Gets the size of a page of memory.
+ */
+uintptr_t
+PatchTransaction::PageSize() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+}
+
+/**
+ * @brief Collects every page touched by the queued writes in [first, last).
+ * @param pages Returns the pages, sorted and without duplicates.
+ */
+void
+PatchTransaction::CollectPages(
+    size_t first,
+    size_t last,
+    std::vector<uintptr_t> &pages
+) const {
+    const uintptr_t page_size = PageSize();
+
+    pages.clear();
+    for (size_t i = first; i < last; i++) {
+        const PendingWrite &w = writes[i];
+        uintptr_t first_page = w.addr & ~(page_size - 1);
+        uintptr_t last_page = (w.addr + w.size - 1) & ~(page_size - 1);
+        for (uintptr_t page = first_page; page <= last_page; page += page_size) {
+            pages.push_back(page);
+        }
+    }
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+}
+
+/**
+ * @brief Queues a write of the given buffer to the given address.
+ */
+void
+PatchTransaction::Write(
+    uintptr_t addr,
+    const void *buf,
+    size_t size
+) {
+    if (!size) { return; }
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(buf);
+    writes.push_back({ addr, data.size(), size });
+    data.insert(data.end(), bytes, bytes + size);
+}
+
+/**
+ * @brief Queues a memset of the given region to the given byte value.
+ */
+void
+PatchTransaction::Fill(
+    uintptr_t addr,
+    uint8_t c,
+    size_t size
+) {
+    if (!size) { return; }
+
+    writes.push_back({ addr, data.size(), size });
+    data.insert(data.end(), size, c);
+}
+
+/**
+ * @brief Applies every queued write.
+ *
+ * Writes are applied in the order they were queued. The transaction is
+ * empty after this call, regardless of whether it succeeded.
+ *
+ * @return True if every write was applied, false if a page could not be
+ *         unprotected. In the latter case, no writes are performed.
+ */
+bool
+PatchTransaction::Commit() {
+    protectCalls = 0;
+    if (writes.empty()) { return true; }
+
+    const uintptr_t page_size = PageSize();
+
+    // Collect every page touched by a write, along with the full range.
+    std::vector<uintptr_t> pages;
+    CollectPages(0, writes.size(), pages);
+    uintptr_t lo = UINTPTR_MAX, hi = 0;
+    for (const PendingWrite &w : writes) {
+        lo = (std::min)(lo, w.addr);
+        hi = (std::max)(hi, w.addr + w.size);
+    }
+
+    // Unprotect each page, backing out if any of them fail.
+    std::vector<DWORD> old_protect(pages.size());
+    bool ok = true;
+    size_t unprotected = 0;
+    for (; unprotected < pages.size(); unprotected++) {
+        if (!VirtualProtect(reinterpret_cast<void*>(pages[unprotected]),
+                page_size, PAGE_EXECUTE_READWRITE, &old_protect[unprotected])) {
+            _ERROR("Failed to unprotect the page at %p.",
+                reinterpret_cast<void*>(pages[unprotected]));
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok) {
+        for (const PendingWrite &w : writes) {
+            memcpy(reinterpret_cast<void*>(w.addr), &data[w.offset], w.size);
+        }
+    }
+
+    for (size_t i = 0; i < unprotected; i++) {
+        DWORD unused;
+        VirtualProtect(reinterpret_cast<void*>(pages[i]), page_size,
+            old_protect[i], &unused);
+    }
+
+    // Each unprotected page is restored, and a failed page made one more call.
+    protectCalls = (2 * unprotected) + (ok ? 0 : 1);
+
+    if (ok) {
+        FlushInstructionCache(GetCurrentProcess(),
+            reinterpret_cast<void*>(lo), hi - lo);
+        _MESSAGE(
+            "Wrote %zu bytes in %zu patches across %zu pages.",
+            data.size(),
+            writes.size(),
+            pages.size()
+        );
+    }
+
+    writes.clear();
+    data.clear();
+    return ok;
+}
+
+/**
+ * @brief Summarizes the queued writes in [first, last).
+ *
+ * The bounds are values returned by Mark(), and must be taken from before the
+ * transaction is committed.
+ */
+PatchTransaction::Stats
+PatchTransaction::GetStats(
+    size_t first,
+    size_t last
+) const {
+    ASSERT((first <= last) && (last <= writes.size()));
+
+    std::vector<uintptr_t> pages;
+    CollectPages(first, last, pages);
+
+    Stats stats = { 0, last - first, pages.size() };
+    for (size_t i = first; i < last; i++) {
+        stats.bytes += writes[i].size;
+    }
+    return stats;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file PatchTransaction.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes a class which batches writes to the game code.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_PATCH_TRANSACTION_H__
+#define __SKYRIM_UNCAPPER_AE_PATCH_TRANSACTION_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Collects writes to protected memory and applies them all at once.
+ *
+ * Nothing is written until Commit() is called. At that point, each page
+ * touched by a write has its protection changed once, every write is copied
+ * in, and the instruction cache is flushed once for the whole range.
+ */
+class PatchTransaction {
+  public:
+    /// @brief Describes a run of queued writes.
+    struct Stats {
+        size_t bytes;
+        size_t writes;
+        size_t pages;
+    };
+
+  private:
+    /// @brief A single pending write. The bytes are stored in data.
+    struct PendingWrite {
+        uintptr_t addr;
+        size_t offset;
+        size_t size;
+    };
+
+    std::vector<uint8_t> data;
+    std::vector<PendingWrite> writes;
+    size_t protectCalls;
+
+    static uintptr_t PageSize(void);
+    void CollectPages(size_t first, size_t last, std::vector<uintptr_t> &pages) const;
+
+  public:
+    PatchTransaction() : protectCalls(0) {}
+
+    void Write(uintptr_t addr, const void *buf, size_t size);
+    void Fill(uintptr_t addr, uint8_t c, size_t size);
+    bool Commit(void);
+    Stats GetStats(size_t first, size_t last) const;
+
+    /**
+     * @brief Gets the index of the next write to be queued, for use with
+     *        GetStats().
+     */
+    inline size_t Mark() const { return writes.size(); }
+
+    /// @brief Gets the number of VirtualProtect calls made by the last Commit().
+    inline size_t ProtectCalls() const { return protectCalls; }
+
+    /**
+     * @brief Queues a write of a trivially copyable value.
+     */
+    template <typename T>
+    void
+    Write(
+        uintptr_t addr,
+        T val
+    ) {
+        Write(addr, &val, sizeof(val));
+    }
+};
+
+#endif /* __SKYRIM_UNCAPPER_AE_PATCH_TRANSACTION_H__ */
@@ -0,0 +1,61 @@
+/**
+ * @file PhaseTimer.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the PhaseTimer class.
+ * @bug No known bugs.
+ */
+
+#include "PhaseTimer.h"
+
+#include <Windows.h>
+
+#include "common/IErrors.h"
+
+/**
+ * @brief Reads the performance counter.
+ */
+int64_t
+PhaseTimer::Now() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+/**
+ * @brief Gets the number of milliseconds since the timer was created.
+ */
+double
+PhaseTimer::ElapsedMs() const {
+    // The frequency is fixed at boot, so it only needs to be read once.
+    static const int64_t frequency = []() {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        return freq.QuadPart;
+    }();
+
+    return (Now() - start) * 1000.0 / frequency;
+}
+
+/**
+ * @brief Logs the time since the timer was created as the duration of the
+ *        given phase.
+ */
+void
+PhaseTimer::Log(
+    const char *phase
+) const {
+    Log(phase, ElapsedMs());
+}
+
+/**
+ * @brief Logs the given duration of the given phase.
+ *
+ * This is for phases which were measured on a thread which must not log.
+ */
+void
+PhaseTimer::Log(
+    const char *phase,
+    double ms
+) {
+    _MESSAGE("Timing: %-32s %10.3f ms", phase, ms);
+}
@@ -0,0 +1,34 @@
+/**
+ * @file PhaseTimer.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes a timer used to measure the phases of our startup.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_PHASE_TIMER_H__
+#define __SKYRIM_UNCAPPER_AE_PHASE_TIMER_H__
+
+#include <cstdint>
+
+/**
+ * @brief Measures the time since it was created with the performance counter.
+ *
+ * Durations are logged in a fixed format, so that the phases of a launch can
+ * be picked out of the log and compared against another.
+ */
+class PhaseTimer {
+  private:
+    int64_t start;
+
+    static int64_t Now(void);
+
+  public:
+    PhaseTimer() : start(Now()) {}
+
+    double ElapsedMs(void) const;
+    void Log(const char *phase) const;
+
+    static void Log(const char *phase, double ms);
+};
+
+#endif /* __SKYRIM_UNCAPPER_AE_PHASE_TIMER_H__ */
@@ -0,0 +1,147 @@
+/**
+ * @file PlayerCache.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the player value cache.
+ * @bug No known bugs.
+ *
+ * Exp is often gained in bursts (spell hits, sneaking, crafting), and each
+ * gain used to read the player level and skill level back out of the game.
+ * Instead, each thread keeps the values it has read, tagged with a global
+ * generation. The generation is advanced whenever the values may have changed:
+ * when we modify them ourselves, when the game levels up a skill or the
+ * player, and once per frame through an SKSE task. The task is only queued
+ * when a cache has been filled, so idle frames cost nothing.
+ *
+ * If the task interface is unavailable, caching is disabled entirely.
+ */
+
+#include "PlayerCache.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include "RelocFn.h"
+#include "ReusableTask.h"
+#include "SkillSlot.h"
+
+/// @brief The values read by the current thread.
+struct PlayerCacheData {
+    uint64_t generation;
+    bool haveLevel;
+    unsigned int level;
+    uint32_t haveBase;
+    float base[SkillSlot::kCount];
+};
+
+static_assert(SkillSlot::kCount <= 32, "Skill mask is too small.");
+
+/// @brief The current cache generation. Caches tagged with any other value
+///        are stale.
+static std::atomic<uint64_t> cacheGeneration(1);
+
+/// @brief The SKSE task interface, or null if caching is disabled.
+static SKSETaskInterface *taskInterface;
+
+/// @brief The cache of the current thread.
+static thread_local PlayerCacheData threadCache;
+
+/**
+ * @brief Invalidates the cache at the end of the frame it was queued in.
+ */
+class InvalidatePlayerCacheTask : public ReusableTask {
+  protected:
+    virtual void
+    Execute() {
+        InvalidatePlayerCache();
+    }
+};
+
+/// @brief The task queued to invalidate the cache each frame.
+static InvalidatePlayerCacheTask invalidateTask;
+
+/**
+ * @brief Sets up the player cache.
+ * @param tasks The SKSE task interface, or null if it could not be found.
+ */
+void
+InitPlayerCache(
+    SKSETaskInterface *tasks
+) {
+    taskInterface = tasks;
+}
+
+/**
+ * @brief Marks every cached player value as stale.
+ */
+void
+InvalidatePlayerCache() {
+    cacheGeneration.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Gets the cache of the current thread, clearing it if it is stale.
+ * @return The cache, or null if caching is disabled.
+ */
+static PlayerCacheData *
+GetThreadCache() {
+    if (!taskInterface) {
+        return nullptr;
+    }
+
+    PlayerCacheData *cache = &threadCache;
+    uint64_t generation = cacheGeneration.load(std::memory_order_acquire);
+    if (cache->generation != generation) {
+        cache->generation = generation;
+        cache->haveLevel = false;
+        cache->haveBase = 0;
+
+        // Make sure the values we're about to cache only live for this frame.
+        invalidateTask.Queue(taskInterface);
+    }
+
+    return cache;
+}
+
+/**
+ * @brief Gets the level of the player, reading it from the game at most once
+ *        per frame.
+ */
+unsigned int
+GetCachedPlayerLevel() {
+    PlayerCacheData *cache = GetThreadCache();
+    if (!cache) {
+        return GetPlayerLevel();
+    }
+
+    if (!cache->haveLevel) {
+        cache->level = GetPlayerLevel();
+        cache->haveLevel = true;
+    }
+
+    return cache->level;
+}
+
+/**
+ * @brief Gets the base value of a player attribute, reading it from the game
+ *        at most once per frame.
+ *
+ * Only skills are cached. Other attributes are always read from the game.
+ */
+float
+GetCachedPlayerAVOBase(
+    ActorAttribute::t attr
+) {
+    PlayerCacheData *cache = ActorAttribute::IsSkill(attr) ? GetThreadCache() : nullptr;
+    if (!cache) {
+        return PlayerAVOGetBase(attr);
+    }
+
+    SkillSlot::t slot = SkillSlot::FromAttribute(attr);
+    uint32_t bit = 1U << slot;
+    if (!(cache->haveBase & bit)) {
+        cache->base[slot] = PlayerAVOGetBase(attr);
+        cache->haveBase |= bit;
+    }
+
+    return cache->base[slot];
+}
@@ -0,0 +1,20 @@
+/**
+ * @file PlayerCache.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes a per-frame cache of the player values read by our hooks.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_PLAYER_CACHE_H__
+#define __SKYRIM_UNCAPPER_AE_PLAYER_CACHE_H__
+
+#include "PluginAPI.h"
+
+#include "ActorAttribute.h"
+
+void InitPlayerCache(SKSETaskInterface *tasks);
+void InvalidatePlayerCache(void);
+unsigned int GetCachedPlayerLevel(void);
+float GetCachedPlayerAVOBase(ActorAttribute::t attr);
+
+#endif /* __SKYRIM_UNCAPPER_AE_PLAYER_CACHE_H__ */
@@ -13,12 +13,32 @@
 
 #include "ActorAttribute.h"
 
-float *GetFloatGameSetting(const char *var);
+/**
+ * @brief Encodes the float game settings which are read by our hooks.
+ *
+ * Each of these is looked up once and cached, so that the hooks never have to
+ * search the game settings collection.
+ */
+class GameSetting {
+  public:
+    enum t {
+        EnchantingCostExponent,
+        EnchantingSkillCostBase,
+        EnchantingSkillCostScale,
+        EnchantingSkillCostMult,
+        LegendarySkillResetValue,
+        kCount
+    };
+};
+
+void CacheGameSettings(void);
+float *GetFloatGameSetting(GameSetting::t var);
 UInt16 GetPlayerLevel(void);
 void *GetPlayerActorValueOwner(void);
 float PlayerAVOGetBase(ActorAttribute::t attr);
 float PlayerAVOGetCurrent_Original(void *av, ActorAttribute::t attr);
 void PlayerAVOModBase(ActorAttribute::t attr, float val);
 void PlayerAVOModCurrent(UInt32 unk1, ActorAttribute::t attr, float val);
+void PlayerAVOApplyLevelUp(const ActorAttributeLevelUp &level_up);
 
 #endif /* __SKYRIM_UNCAPPER_AE_RELOC_FN_H__ */
@@ -30,16 +30,21 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <future>
+#include <string>
+#include <type_traits>
 
 #include "GameSettings.h"
-#include "BranchTrampoline.h"
-#include "SafeWrite.h"
 #include "skse_version.h"
 #include "addr_lib/versionlibdb.h"
 
+#include "HookArena.h"
 #include "Hook_Skill.h"
 #include "HookWrappers.h"
-#include "SafeMemSet.h"
+#include "OffsetCache.h"
+#include "PatchTransaction.h"
+#include "PhaseTimer.h"
+#include "PlayerCache.h"
 #include "Settings.h"
 
 /// @brief Encodes the various types of hooks which can be injected.
@@ -56,7 +61,7 @@ struct HookType {
     };
 
     /// @brief Gets the patch size of the given hook type.
-    static size_t
+    static constexpr size_t
     Size(
         t type
     ) {
@@ -84,8 +89,9 @@ struct HookType {
         return ret;
     }
 
-    /// @brief Gets the allocation size of the hook in the branch trampoline.
-    static size_t
+    /// @brief Gets the size of the thunk or slot the hook needs in the hook
+    ///        arena.
+    static constexpr size_t
     AllocSize(
         t type
     ) {
@@ -114,17 +120,110 @@ struct HookType {
     }
 };
 
-/// @brief Describes a patch to be applied by a RelocPatch<T>.
+/**
+ * @brief Encodes which registers a hook leaves untouched for the game code it
+ *        returns to.
+ *
+ * This is what each wrapper saves, not what is live at each site. Hooks which
+ * replace a call or a function entry only need to follow the calling
+ * convention. Hooks injected in the middle of game code must keep whatever
+ * the code around them still uses.
+ */
+struct HookSave {
+    enum t {
+        /// @brief The signature has no hook.
+        None,
+
+        /// @brief Only the registers the calling convention preserves.
+        CallConvention,
+
+        /// @brief Every register, except rax and the flags.
+        AllButRaxAndFlags,
+
+        /// @brief Every register, except the flags.
+        AllButFlags,
+
+        /// @brief Every register and the flags.
+        All
+    };
+
+    /// @brief Converts the given save set to a string for the patch report.
+    static constexpr const char *
+    Str(
+        t save
+    ) {
+        const char *ret = nullptr;
+
+        switch (save) {
+            case None:
+                ret = "-";
+                break;
+            case CallConvention:
+                ret = "abi";
+                break;
+            case AllButRaxAndFlags:
+                ret = "-rax,fl";
+                break;
+            case AllButFlags:
+                ret = "-fl";
+                break;
+            case All:
+                ret = "all";
+                break;
+            default:
+                HALT("Cannot get the name of an invalid save set.");
+        }
+
+        return ret;
+    }
+};
+
+/**
+ * @brief Gets the address of the given hook.
+ *
+ * Function addresses can't be cast to integers in a constant expression, so
+ * the signature table stores this getter instead.
+ */
+template <auto Fn>
+static uintptr_t
+HookAddress() {
+    return reinterpret_cast<uintptr_t>(Fn);
+}
+
+/**
+ * @brief Stores a found address in the given variable.
+ *
+ * As with HookAddress(), this lets the signature table link to variables of
+ * any pointer type while remaining a constant expression.
+ */
+template <auto *Var>
+static void
+StoreResult(
+    uintptr_t addr
+) {
+    *Var = reinterpret_cast<std::remove_pointer_t<decltype(Var)>>(addr);
+}
+
+/**
+ * @brief Describes a patch to be applied by ApplyGamePatches().
+ *
+ * Signatures are plain data, so that the entire table can be built and checked
+ * at compile time. Use Object() and Patch() to create them.
+ */
 struct CodeSignature {
     const char* name;
     HookType::t hook_type;
-    uintptr_t hook;
+    uintptr_t (*hook)(void);
+    HookSave::t save;
     unsigned long long id;
     size_t patch_size;
+    size_t hook_size;
+    size_t alloc_size;
     ptrdiff_t offset;
     uintptr_t *return_trampoline;
     bool (*enabled)(void);
-    void **result;
+    void (*result)(uintptr_t);
+    bool (*data_patch)(PatchTransaction&, uintptr_t, size_t);
 
     // Optional argument for finding new addresses.
 #ifdef _DEBUG
@@ -138,6 +237,7 @@ struct CodeSignature {
      *                is enabled.
      * @param hook_type The non-none type of hook to be inserted.
      * @param hook The hook to install with this patch.
+     * @param save The registers the hook preserves for the patched code.
      * @param id The relocatable object/function id.
      * @param patch_size The size of the code to be overwritten.
      * @param return_trampoline The trampoline to be filled with the patch
@@ -146,11 +246,13 @@ struct CodeSignature {
      * @param known_offset The known-correct offset into the binary for
      *                     this game version.
      */
-    CodeSignature(
+    static constexpr CodeSignature
+    Patch(
         const char* name,
         bool (*enabled)(void),
         HookType::t hook_type,
-        uintptr_t hook,
+        uintptr_t (*hook)(void),
+        HookSave::t save,
         unsigned long long id,
         size_t patch_size,
         uintptr_t *return_trampoline = nullptr,
@@ -158,48 +260,98 @@ struct CodeSignature {
 #ifdef _DEBUG
         , uintptr_t known_offset = 0
 #endif
-    ) : name(name),
-        enabled(enabled),
-        hook_type(hook_type),
-        hook(hook),
-        id(id),
-        patch_size(patch_size),
-        offset(offset),
-        return_trampoline(return_trampoline),
+    ) {
+        return {
+            name,
+            hook_type,
+            hook,
+            save,
+            id,
+            patch_size,
+            HookType::Size(hook_type),
+            HookArena::SlotSize(HookType::AllocSize(hook_type)),
+            offset,
+            return_trampoline,
+            enabled,
+            nullptr,
+            nullptr
 #ifdef _DEBUG
-        known_offset(known_offset),
+            , known_offset
 #endif
-        result(nullptr)
-    {}
+        };
+    }
 
     /**
      * @brief Creates a new code signature which links to a game object.
      * @param name The name of the code signature.
      * @param id The relocatable function id.
-     * @param result The pointer to be filled with the found result.
+     * @param result The function to be called with the found result.
      * @param known_offset The known-correct offset into the binary for
      *                     this game version.
      */
-    CodeSignature(
+    static constexpr CodeSignature
+    Object(
         const char *name,
         unsigned long long id,
-        void **result
+        void (*result)(uintptr_t)
 #ifdef _DEBUG
         , uintptr_t known_offset = 0
 #endif
-    ) : name(name),
-        enabled(nullptr),
-        hook_type(HookType::None),
-        hook(0),
-        id(id),
-        patch_size(0),
-        offset(0),
-        return_trampoline(nullptr),
+    ) {
+        return {
+            name,
+            HookType::None,
+            nullptr,
+            HookSave::None,
+            id,
+            0,
+            0,
+            0,
+            0,
+            nullptr,
+            nullptr,
+            result,
+            nullptr
 #ifdef _DEBUG
-        known_offset(known_offset),
+            , known_offset
 #endif
-        result(result)
-    {}
+        };
+    }
+
+    /**
+     * @brief Gives the patch a way to rewrite its site without the hook.
+     *
+     * The data patch is given the address and size of the site, and must
+     * either queue a write covering all of it and return true, or queue
+     * nothing and return false. In the latter case, the hook is installed as
+     * usual. It may allocate no more of the hook arena than the hook
+     * would have.
+     *
+     * @param data_patch The function which patches the site.
+     */
+    constexpr CodeSignature
+    WithDataPatch(
+        bool (*data_patch)(PatchTransaction&, uintptr_t, size_t)
+    ) const {
+        CodeSignature ret = *this;
+        ret.data_patch = data_patch;
+        return ret;
+    }
+
+    /**
+     * @brief Checks that the signature is internally consistent.
+     */
+    constexpr bool
+    IsValid() const {
+        bool has_hook = (hook_type != HookType::None)
+                     && (hook_type != HookType::Nop);
+        return (hook_size <= patch_size)
+            && ((hook != nullptr) == has_hook)
+            && ((save != HookSave::None) == has_hook)
+            && ((result != nullptr) == (hook_type == HookType::None))
+            && (!return_trampoline || has_hook)
+            && (!data_patch || (has_hook && !return_trampoline));
+    }
 
     /**
      * @brief Checks if the patch has been disabled.
@@ -224,6 +376,18 @@ extern "C" {
 }
 ///@}
 
+/**
+ * @brief The hook our charge wrapper jumps to. Set by SelectHookVariants().
+ */
+extern "C" {
+    uintptr_t CalculateChargePointsPerUse_HookTarget;
+}
+
+/**
+ * @brief Holds every thunk and address slot used by our hooks.
+ */
+static HookArena hookArena;
+
 /**
  * @brief Holds references to the global game variables we need.
  */
@@ -245,531 +409,980 @@ static void (*PlayerAVOModCurrent_Entry)(void*, UInt32, ActorAttribute::t, float
 ///@}
 
 /**
- * @brief The signature used to find the player object.
+ * @brief Replaces the maximum skill level load in SkillCapPatch with a load
+ *        of our own cap, when every skill has the same cap.
+ *
+ * The game loads the maximum from a RIP-relative constant, and the skill ID is
+ * only in esi. RIP-relative operands can't take an index register, so a
+ * per-skill table would need an absolute 32-bit address, which our memory
+ * never has. Instead, the displacement is pointed at a single float in the
+ * hook arena, which is always within reach of the game code. This uses the
+ * same slot the Call6 hook would have, and removes the call entirely.
+ *
+ * When the caps differ, the site keeps calling SkillCapPatch_Wrapper, which
+ * reads them from SkillCapTable.
+ *
+ * @return True if the load was patched, false if the hook must be used.
  */
-static const CodeSignature kThePlayer_ObjectSig(
-    /* name */   "g_thePlayer",
-    /* id */     403521,
-    /* result */ reinterpret_cast<void**>(&playerObject)
-);
+static bool
+SkillCapDirectLoad(
+    PatchTransaction &tx,
+    uintptr_t addr,
+    size_t size
+) {
+    // movss xmm10, dword ptr [rip + disp32]
+    static const uint8_t kLoad[] = { 0xF3, 0x44, 0x0F, 0x10, 0x15 };
+    ASSERT(size == sizeof(kLoad) + sizeof(int32_t));
+
+    if (!SkillCapsAreUniform()) {
+        _MESSAGE("Skill caps differ between skills; calling the skill cap hook.");
+        return false;
+    }
+
+    // Arena slots are aligned, so the hot reload store is atomic.
+    float *slot = reinterpret_cast<float*>(hookArena.Allocate(sizeof(float)));
+    *slot = SkillCapTable[0];
+
+    ptrdiff_t rel = reinterpret_cast<ptrdiff_t>(slot) - static_cast<ptrdiff_t>(addr + size);
+    ASSERT((rel >= INT32_MIN) && (rel <= INT32_MAX));
+
+    tx.Write(addr, kLoad, sizeof(kLoad));
+    tx.Write<int32_t>(addr + sizeof(kLoad), static_cast<int32_t>(rel));
+
+    SkillCapDirectSlot = slot;
+    _MESSAGE("Every skill is capped at %f; loading the cap directly.", *slot);
+    return true;
+}
 
 /**
- * @brief The signature used to find the game settings object.
+ * @brief Lists all the code signatures to be resolved/applied
+ *        by ApplyGamePatches().
+ *
+ * This table is built entirely at compile time.
  */
-static const CodeSignature kGameSettingCollection_ObjectSig(
-    /* name */   "g_gameSettingCollection",
-    /* id */     400782,
-    /* result */ reinterpret_cast<void**>(&gameSettings)
-);
+///@{
+static constexpr CodeSignature kGameSignatures[] = {
+    /**
+     * @brief The signature used to find the player object.
+     */
+    CodeSignature::Object(
+        /* name */   "g_thePlayer",
+        /* id */     403521,
+        /* result */ StoreResult<&playerObject>
+    ),
+
+    /**
+     * @brief The signature used to find the game settings object.
+     */
+    CodeSignature::Object(
+        /* name */   "g_gameSettingCollection",
+        /* id */     400782,
+        /* result */ StoreResult<&gameSettings>
+    ),
+
+    /**
+     * @brief The signature used to find the games "GetLevel" function.
+     */
+    CodeSignature::Object(
+        /* name */   "GetLevel",
+        /* id */     37334,
+        /* result */ StoreResult<&GetLevel_Entry>
+    ),
+
+    /**
+     * @brief Gets a game setting in the settings collection.
+     */
+    CodeSignature::Object(
+        /* name */   "GetGameSetting",
+        /* id */     22788,
+        /* result */ StoreResult<&GetGameSetting_Entry>
+    ),
+
+    /**
+     * @brief The code signature used to find the games PlayerAVOGetBase() fn.
+     */
+    CodeSignature::Object(
+        /* name */   "PlayerAVOGetBase",
+        /* id */     38464,
+        /* result */ StoreResult<&PlayerAVOGetBase_Entry>
+    ),
+
+    /**
+     * @brief The code signature used to find the games PlayerAVOGetCurrent() fn.
+     */
+    CodeSignature::Object(
+        /* name */   "PlayerAVOGetCurrent",
+        /* id */     38462,
+        /* result */ StoreResult<&PlayerAVOGetCurrent_Entry>
+    ),
+
+    /**
+     * @brief Mods the base value of an attribute of the player.
+     */
+    CodeSignature::Object(
+        /* name */   "PlayerAVOModBase",
+        /* id */     38466,
+        /* result */ StoreResult<&PlayerAVOModBase_Entry>
+    ),
+
+    /**
+     * @brief Mods the current value of an attribute of the player.
+     */
+    CodeSignature::Object(
+        /* name */   "PlayerAVOModCurrent",
+        /* id */     38467,
+        /* result */ StoreResult<&PlayerAVOModCurrent_Entry>
+    ),
+
+    /**
+     * @brief The signature and offset used to redirect to the code which alters
+     *        the real skill cap.
+     *
+     * The offset into this signature overwrites a movess instruction and instead
+     * redirects to our handler. Note that the last four bytes of this instruction
+     * must be overwritten with 0x90 (NOP), at the request of the author of the
+     * eXPerience mod (17751). This is handled by the RelocPatch interface.
+     *
+     * This signature hooks into the following function:
+     * ...
+     * 48 8b 01        MOV        RAX,qword ptr [param_1]
+     * ff 50 18        CALL       qword ptr [RAX + 0x18]
+     * 44 0f 28 c0     MOVAPS     XMM8,XMM0
+     * ### kHook_SkillCapPatch_Ent ###
+     * f3 44 0f        MOVSS      XMM10,dword ptr [DAT_14161af50] = 42C80000h 100.0
+     * 10 15
+     * ### kHook_SkillCapPatch_Ret ###
+     * c1 c2 f0 00
+     * 41 0f 2f c2     COMISS     XMM0,XMM10
+     * 0f 83 d8        JNC        LAB_14070ef71
+     * 02 00 00
+     * ...
+     *
+     * Note that the code being patched expects the current skill level in XMM0 and
+     * the maximum skill level in XMM10.
+     *
+     * We have no liveness data for the code around the hook, so the wrapper
+     * saves every register but XMM10, and the flags.
+     */
+    CodeSignature::Patch(
+        /* name */       "SkillCapPatch",
+        /* enabled */    []() { return SettingsGuard().Get().IsSkillCapEnabled(); },
+        /* hook_type */  HookType::Call6,
+        /* hook */       HookAddress<&SkillCapPatch_Wrapper>,
+        /* save */       HookSave::All,
+        /* id */         41561,
+        /* patch_size */ 9,
+        /* trampoline */ nullptr,
+        /* offset */     0x76
+    ).WithDataPatch(SkillCapDirectLoad),
+
+    /**
+     * @brief Replaces the original charge point calculation function call with a
+     *        call to our modified function which caps the enchant level at 199.
+     *
+     * This is a bug fix for the original equation, which gives invalid results for
+     * enchantment levels at 200 or above.
+     * 
+     * Note that we also replace the PlayerAVOGetCurrent() call, so that we can
+     * enforce a different formula cap for enchanting charge and magnitude.
+     */
+    CodeSignature::Patch(
+        /* name */       "CalculateChargePointsPerUse",
+        /* enabled */    []() { return SettingsGuard().Get().IsEnchantPatchEnabled(); },
+        /* hook_type */  HookType::Call6,
+        /* hook */       HookAddress<&CalculateChargePointsPerUse_Wrapper>,
+        /* save */       HookSave::CallConvention,
+        /* id */         51449,
+        /* patch_size */ 14,
+        /* trampoline */ nullptr,
+        /* offset */     0x32a
+    ),
+
+    /**
+     * @brief Caps the effective skill level in calculations by always returning
+     *        a damaged result.
+     *
+     * This patch redirects to our hook, with an assembly wrapper allowing the
+     * hook to call the original implementation. The assembly wrapper reimplements
+     * the first 6 bytes, then jumps to the instruction after the hook.
+     *
+     * Only the player is capped. Other actors read their values through their
+     * own actor value owner, which we have no signature for. The formula caps
+     * don't depend on the actor, so a hook for them could share the clamp
+     * table in ClampSkillFormula() as is, with no per-actor state.
+     */
+    CodeSignature::Patch(
+        /* name */       "PlayerAVOGetCurrent (Patch)",
+        /* enabled */    []() { return SettingsGuard().Get().IsSkillFormulaCapEnabled(); },
+        /* hook_type */  HookType::Jump6,
+        /* hook */       HookAddress<&PlayerAVOGetCurrent_Hook>,
+        /* save */       HookSave::CallConvention,
+        /* id */         38462,
+        /* patch_size */ 6,
+        /* trampoline */ &PlayerAVOGetCurrent_ReturnTrampoline
+    ),
+
+    /**
+     * @brief Overwrites the skill display PlayerAVOGetCurrent() call to display
+     *        the actual, non-damaged, skill level.
+     *
+     * The function that is overwritten by our PlayerAVOGetCurrent() hook is also
+     * used to display the skill level in the skills menu.
+     *
+     * So as to not confuse players, this hook is used to force the skills menu to
+     * show the actual skill level, not the damaged value.
+     *
+     * This hook replaces the call instruction which would call
+     * PlayerAVOGetCurrent() with a call to our reimplemented
+     * PlayerAVOGetCurrent_Original().
+     */
+    CodeSignature::Patch(
+        /* name */       "DisplayTrueSkillLevel",
+        /* enabled */    []() { return SettingsGuard().Get().IsSkillFormulaCapEnabled(); },
+        /* hook_type */  HookType::Jump6,
+        /* hook */       HookAddress<&DisplayTrueSkillLevel_Hook>,
+        /* save */       HookSave::CallConvention,
+        /* id */         52525,
+        /* patch_size */ 7,
+        /* trampoline */ &DisplayTrueSkillLevel_ReturnTrampoline,
+        /* offset */     0x120
+    ),
+
+    /**
+     * @brief Overwrites the skill color displays call to PlayerAVOGetCurrent to
+     *        call the original function.
+     * 
+     * This patch exists for the same reason as the above patch, except its concern
+     * is in getting the skill number to display as the correct color, not number.
+     */
+    CodeSignature::Patch(
+        /* name */       "DisplayTrueSkillColor",
+        /* enabled */    []() { return SettingsGuard().Get().IsSkillFormulaCapEnabled(); },
+        /* hook_type */  HookType::Call6,
+        /* hook */       HookAddress<&DisplayTrueSkillColor_Hook>,
+        /* save */       HookSave::CallConvention,
+        /* id */         52945,
+        /* patch_size */ 10,
+        /* trampoline */ nullptr,
+        /* offset */     0x32
+    ),
+
+    /**
+     * @brief Prevents the skill training function from applying our multipliers.
+     */
+    CodeSignature::Patch(
+        /* name */       "ImproveSkillByTraining",
+        /* enabled */    []() { return SettingsGuard().Get().IsSkillExpEnabled(); },
+        /* hook_type */  HookType::Call5,
+        /* hook */       HookAddress<&ImprovePlayerSkillPoints_Original>,
+        /* save */       HookSave::CallConvention,
+        /* id */         41562,
+        /* patch_size */ 5,
+        /* trampoline */ nullptr,
+        /* offset */     0x98
+    ),
+
+    /**
+     * @brief Applies the multipliers from the INI file to skill experience.
+     */
+    CodeSignature::Patch(
+        /* name */       "ImprovePlayerSkillPoints",
+        /* enabled */    []() { return SettingsGuard().Get().IsSkillExpEnabled(); },
+        /* hook_type */  HookType::Jump6,
+        /* hook */       HookAddress<&ImprovePlayerSkillPoints_Hook>,
+        /* save */       HookSave::CallConvention,
+        /* id */         41561,
+        /* patch_size */ 6,
+        /* trampoline */ &ImprovePlayerSkillPoints_ReturnTrampoline
+    ),
+
+    /**
+     * @brief The signature and offset used to hook into the perk pool modification
+     *        routine.
+     *
+     * Upon entry into our hook, we run our function. We then reimplement the final
+     * few instructions in the return path of the function we hooked into. This way,
+     * we need only modify one instruction and can still use the RelocPatch interface.
+     */
+    CodeSignature::Patch(
+        /* name */       "ModifyPerkPool",
+        /* enabled */    []() { return SettingsGuard().Get().IsPerkPointsEnabled(); },
+        /* hook_type */  HookType::Jump6,
+        /* hook */       HookAddress<&ModifyPerkPool_Wrapper>,
+        /* save */       HookSave::AllButRaxAndFlags,
+        /* id */         52538,
+        /* patch_size */ 9,
+        /* trampoline */ &ModifyPerkPool_ReturnTrampoline,
+        /* offset */     0x70
+    ),
+
+    /**
+     * @brief Passes the EXP gain originally calculated by the game to our hook for
+     *        further modification.
+     */
+    CodeSignature::Patch(
+        /* name */       "ImproveLevelExpBySkillLevel",
+        /* enabled */    []() { return SettingsGuard().Get().IsLevelExpEnabled(); },
+        /* hook_type */  HookType::Call6,
+        /* hook */       HookAddress<&ImproveLevelExpBySkillLevel_Wrapper>,
+        /* save */       HookSave::AllButFlags,
+        /* id */         41561,
+        /* patch_size */ 8,
+        /* trampoline */ nullptr,
+        /* offset */     0x2D7
+    ),
+
+    /**
+     * @brief Overwrites the attribute level-up function to adjust the gains based
+     *        on the players attribute selection.
+     * 
+     * We inject this patch just after the player has made their attribute selection,
+     * and replace what would have been a call to player_avo->ModBase(...). Then,
+     * we manually invoke ModBase and ModCurrent for the attributes and carry weight
+     * as specified in the INI file.
+     * 
+     * Note that this patch overwrites the carry weight change done in the games code
+     * as well. It also means the game settings which would usually control these
+     * attributes are ignored.
+     */
+    CodeSignature::Patch(
+        /* name */       "ImproveAttributeWhenLevelUp",
+        /* enabled */    []() { return SettingsGuard().Get().IsAttributePointsEnabled(); },
+        /* hook_type */  HookType::Call6,
+        /* hook */       HookAddress<&ImproveAttributeWhenLevelUp_Hook>,
+        /* save */       HookSave::CallConvention,
+        /* id */         51917,
+        /* patch_size */ 0x2b,
+        /* trampoline */ nullptr,
+        /* offset */     0x93
+    ),
+
+    /**
+     * @brief Alters the reset level of legendarying a skill.
+     *
+     * Unfortunately, Kasplat has no idea why altering this particular jump makes
+     * the change we want.
+     */
+    CodeSignature::Patch(
+        /* name */       "LegendaryResetSkillLevel",
+        /* enabled */    []() { return SettingsGuard().Get().IsLegendaryEnabled(); },
+        /* hook_type */  HookType::Call6,
+        /* hook */       HookAddress<&LegendaryResetSkillLevel_Wrapper>,
+        /* save */       HookSave::AllButFlags,
+        /* id */         52591,
+        /* patch_size */ 6,
+        /* trampoline */ nullptr,
+        /* offset */     0x1d7
+    ),
+
+    /**
+     * @brief Replaces the call to the legendary condition function with our own.
+     *
+     * This patch simply overwrites the call to the original legendary condition
+     * check function with a call to our own reimplemented condition check function.
+     */
+    CodeSignature::Patch(
+        /* name */       "CheckConditionForLegendarySkill",
+        /* enabled */    []() { return SettingsGuard().Get().IsLegendaryEnabled(); },
+        /* hook_type */  HookType::Jump6,
+        /* hook */       HookAddress<&CheckConditionForLegendarySkill_Wrapper>,
+        /* save */       HookSave::CallConvention,
+        /* id */         52520,
+        /* patch_size */ 10,
+        /* trampoline */ &CheckConditionForLegendarySkill_ReturnTrampoline,
+        /* offset */     0x157
+    ),
+
+    /**
+     * @brief Hooks into the legendary button display code to allow it to be hidden.
+     *
+     * The assembly for this hook is as follows:
+     * 48 8b 0d 2e d4 6b 02 	mov    0x26bd42e(%rip),%rcx        # 0x142fc1b78 (player)
+     * 48 81 c1 b8 00 00 00 	add    $0xb8,%rcx <- Player actor state
+     * 48 8b 01             	mov    (%rcx),%rax
+     * 41 8b d7             	mov    %r15d,%edx <- Skill ID.
+     * ff 50 18             	callq  *0x18(%rax)
+     * 0f 2f 05 bf 57 d1 00 	comiss 0xd157bf(%rip),%xmm0        # 0x141619f20
+     * 72 6b                	jb     0x1409047ce
+     * 48 8d 05 d6 b9 e9 00 	lea    0xe9b9d6(%rip),%rax        # 0x1417a0140
+     * 48 89 85 c0 00 00 00 	mov    %rax,0xc0(%rbp)
+     * 48 8d 3d 58 99 c2 ff 	lea    -0x3d66a8(%rip),%rdi
+     */
+    CodeSignature::Patch(
+        /* name */       "HideLegendaryButton",
+        /* enabled */    []() { return SettingsGuard().Get().IsLegendaryEnabled(); },
+        /* hook_type */  HookType::Jump6,
+        /* hook */       HookAddress<&HideLegendaryButton_Wrapper>,
+        /* save */       HookSave::CallConvention,
+        /* id */         52527,
+        /* patch_size */ 10,
+        /* trampoline */ &HideLegendaryButton_ReturnTrampoline,
+        /* offset */     0x167
+    )
+};
+static constexpr size_t kNumSigs = sizeof(kGameSignatures) / sizeof(kGameSignatures[0]);
+///@}
 
 /**
- * @brief The signature used to find the games "GetLevel" function.
+ * @brief Checks that every signature in the table is internally consistent.
  */
-static const CodeSignature kGetLevel_FunctionSig(
-    /* name */   "GetLevel",
-    /* id */     37334,
-    /* result */ reinterpret_cast<void**>(&GetLevel_Entry)
-);
+static constexpr bool
+CheckSignatureTable() {
+    for (size_t i = 0; i < kNumSigs; i++) {
+        if (!kGameSignatures[i].IsValid()) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(CheckSignatureTable(), "A game signature is malformed.");
 
 /**
- * @brief Gets a game setting in the settings collection.
+ * @brief Gets the hook arena space needed if every patch is enabled.
  */
-static const CodeSignature kGetGameSetting_FunctionSig(
-    /* name */   "GetGameSetting",
-    /* id */     22788,
-    /* result */ reinterpret_cast<void**>(&GetGameSetting_Entry)
-);
+static constexpr size_t
+GetMaxArenaSize() {
+    size_t size = 0;
+    for (size_t i = 0; i < kNumSigs; i++) {
+        size += kGameSignatures[i].alloc_size;
+    }
+    return size;
+}
+
+/// @brief The hook arena space needed if every patch is enabled.
+static constexpr size_t kMaxArenaSize = GetMaxArenaSize();
+static_assert(kMaxArenaSize <= 0x1000,
+              "The hook arena must fit in a single page.");
 
 /**
- * @brief The code signature used to find the games PlayerAVOGetBase() fn.
+ * @brief Hashes the IDs and offsets of the signature table.
+ *
+ * This is stored in the offset cache, so that the cache is thrown out when the
+ * table changes.
  */
-static const CodeSignature kPlayerAVOGetBase_FunctionSig(
-    /* name */   "PlayerAVOGetBase",
-    /* id */     38464,
-    /* result */ reinterpret_cast<void**>(&PlayerAVOGetBase_Entry)
-);
+static constexpr uint64_t
+HashSignatureTable() {
+    uint64_t hash = kFnvOffsetBasis;
+    for (size_t i = 0; i < kNumSigs; i++) {
+        hash = HashOffsetCacheValue(hash, kGameSignatures[i].id);
+        hash = HashOffsetCacheValue(hash, kGameSignatures[i].offset);
+    }
+    return hash;
+}
+
+/// @brief The hash of the signature table, computed when we are compiled.
+static constexpr uint64_t kSignatureTableHash = HashSignatureTable();
+
+/// @brief The opcode for an x86 NOP.
+static const uint8_t kNop = 0x90;
+
+/// @brief The running version of skyrim.
+static unsigned int runningSkyrimVersion;
 
 /**
- * @brief The code signature used to find the games PlayerAVOGetCurrent() fn.
+ * @brief Gets the actor value owner field of the player at the given offset
+ *        into the player object.
  */
-static const CodeSignature kPlayerAVOGetCurrent_FunctionSig(
-    /* name */   "PlayerAVOGetCurrent",
-    /* id */     38462,
-    /* result */ reinterpret_cast<void**>(&PlayerAVOGetCurrent_Entry)
-);
+template <size_t kOffset>
+static void *
+PlayerAVOAt() {
+    return reinterpret_cast<char*>(*playerObject) + kOffset;
+}
 
 /**
- * @brief Mods the base value of an attribute of the player.
+ * @brief Describes the layout of the player object from a given game version
+ *        onwards.
  */
-static const CodeSignature kPlayerAVOModBase_FunctionSig(
-    /* name */   "PlayerAVOModBase",
-    /* id */     38466,
-    /* result */ reinterpret_cast<void**>(&PlayerAVOModBase_Entry)
-);
+struct PlayerLayout {
+    unsigned int min_version;
+    void *(*get_avo)(void);
+};
 
 /**
- * @brief Mods the current value of an attribute of the player.
+ * @brief The layouts of the player object, newest first.
+ *
+ * Versions before 1.6.629 store the actor value owner at offset 0xB0. From
+ * that version on, it is at offset 0xB8.
  */
-static const CodeSignature kPlayerAVOModCurrent_FunctionSig(
-    /* name */   "PlayerAVOModCurrent",
-    /* id */     38467,
-    /* result */ reinterpret_cast<void**>(&PlayerAVOModCurrent_Entry)
-);
+static const PlayerLayout kPlayerLayouts[] = {
+    { RUNTIME_VERSION_1_6_629, PlayerAVOAt<0xB8> },
+    { RUNTIME_VERSION_1_6_317, PlayerAVOAt<0xB0> }
+};
+
+/// @brief The accessor for the player layout of the running game version.
+static void *(*GetPlayerAVO)(void);
 
 /**
- * @brief The signature and offset used to redirect to the code which alters
- *        the real skill cap.
+ * @brief Chooses the player layout accessors for the running game version.
  *
- * The offset into this signature overwrites a movess instruction and instead
- * redirects to our handler. Note that the last four bytes of this instruction
- * must be overwritten with 0x90 (NOP), at the request of the author of the
- * eXPerience mod (17751). This is handled by the RelocPatch interface.
+ * Must be called once the player object has been linked.
+ */
+static void
+SelectPlayerLayout() {
+    ASSERT(playerObject);
+
+    for (const PlayerLayout &layout : kPlayerLayouts) {
+        if (runningSkyrimVersion >= layout.min_version) {
+            GetPlayerAVO = layout.get_avo;
+            return;
+        }
+    }
+
+    HALT("No player layout is known for the running game version.");
+}
+
+/**
+ * @brief Chooses the specialization of each templated hook which matches the
+ *        loaded settings.
+ *
+ * Must be called before the game is patched. The settings these depend on
+ * are kept across reloads by Settings::KeepInstalledPatches().
+ */
+static void
+SelectHookVariants() {
+    SettingsGuard guard;
+    CalculateChargePointsPerUse_HookTarget = guard.Get().IsEnchantChargeLinear()
+        ? HookAddress<&CalculateChargePointsPerUse_Hook<true>>()
+        : HookAddress<&CalculateChargePointsPerUse_Hook<false>>();
+}
+
+/**
+ * @brief Gets the actor value owner field of the player.
  *
- * This signature hooks into the following function:
- * ...
- * 48 8b 01        MOV        RAX,qword ptr [param_1]
- * ff 50 18        CALL       qword ptr [RAX + 0x18]
- * 44 0f 28 c0     MOVAPS     XMM8,XMM0
- * ### kHook_SkillCapPatch_Ent ###
- * f3 44 0f        MOVSS      XMM10,dword ptr [DAT_14161af50] = 42C80000h 100.0
- * 10 15
- * ### kHook_SkillCapPatch_Ret ###
- * c1 c2 f0 00
- * 41 0f 2f c2     COMISS     XMM0,XMM10
- * 0f 83 d8        JNC        LAB_14070ef71
- * 02 00 00
- * ...
+ * The location of this field is dependent on the running version of the game.
+ * The accessor for it is chosen once, by SelectPlayerLayout().
  *
- * Note that the code being patched expects the current skill level in XMM0 and
- * the maximum skill level in XMM10.
+ * @return The actor value owner of the player.
  */
-static const CodeSignature kSkillCapPatch_PatchSig(
-    /* name */       "SkillCapPatch",
-    /* enabled */    []() { return settings.IsSkillCapEnabled(); },
-    /* hook_type */  HookType::Call6,
-    /* hook */       reinterpret_cast<uintptr_t>(SkillCapPatch_Wrapper),
-    /* id */         41561,
-    /* patch_size */ 9,
-    /* trampoline */ nullptr,
-    /* offset */     0x76
-);
+void *
+GetPlayerActorValueOwner() {
+    return GetPlayerAVO();
+}
+
+/**
+ * @brief Builds the key which the signature offset cache is validated against.
+ * @param key Returns the key for the running game and signature table.
+ * @return True if the key could be created, false otherwise.
+ */
+static bool
+MakeOffsetCacheKey(
+    OffsetCacheKey &key
+) {
+    std::string db_path;
+    WIN32_FILE_ATTRIBUTE_DATA db_info;
+    if (!VersionDb().GetFileName(db_path)
+            || !GetFileAttributesExA(db_path.c_str(), GetFileExInfoStandard, &db_info)) {
+        return false;
+    }
+
+    key.runtime_version = runningSkyrimVersion;
+    key.db_size = (static_cast<uint64_t>(db_info.nFileSizeHigh) << 32)
+                | db_info.nFileSizeLow;
+    key.db_mtime = (static_cast<uint64_t>(db_info.ftLastWriteTime.dwHighDateTime) << 32)
+                 | db_info.ftLastWriteTime.dwLowDateTime;
+    key.sig_hash = kSignatureTableHash;
+    return true;
+}
 
 /**
- * @brief Replaces the original charge point calculation function call with a
- *        call to our modified function which caps the enchant level at 199.
+ * @brief Fills in the signature addresses from the offset cache.
  *
- * This is a bug fix for the original equation, which gives invalid results for
- * enchantment levels at 200 or above.
- * 
- * Note that we also replace the PlayerAVOGetCurrent() call, so that we can
- * enforce a different formula cap for enchanting charge and magnitude.
- */
-static const CodeSignature kCalculateChargePointsPerUse_PatchSig(
-    /* name */       "CalculateChargePointsPerUse",
-    /* enabled */    []() { return settings.IsEnchantPatchEnabled(); },
-    /* hook_type */  HookType::Call6,
-    /* hook */       reinterpret_cast<uintptr_t>(CalculateChargePointsPerUse_Wrapper),
-    /* id */         51449,
-    /* patch_size */ 14,
-    /* trampoline */ nullptr,
-    /* offset */     0x32a
-);
-
-/**
- * @brief Caps the effective skill level in calculations by always returning
- *        a damaged result.
- *
- * This patch redirects to our hook, with an assembly wrapper allowing the
- * hook to call the original implementation. The assembly wrapper reimplements
- * the first 6 bytes, then jumps to the instruction after the hook.
- */
-static const CodeSignature kPlayerAVOGetCurrent_PatchSig(
-    /* name */       "PlayerAVOGetCurrent (Patch)",
-    /* enabled */    []() { return settings.IsSkillFormulaCapEnabled(); },
-    /* hook_type */  HookType::Jump6,
-    /* hook */       reinterpret_cast<uintptr_t>(PlayerAVOGetCurrent_Hook),
-    /* id */         38462,
-    /* patch_size */ 6,
-    /* trampoline */ &PlayerAVOGetCurrent_ReturnTrampoline
-);
-
-/**
- * @brief Overwrites the skill display PlayerAVOGetCurrent() call to display
- *        the actual, non-damaged, skill level.
- *
- * The function that is overwritten by our PlayerAVOGetCurrent() hook is also
- * used to display the skill level in the skills menu.
- *
- * So as to not confuse players, this hook is used to force the skills menu to
- * show the actual skill level, not the damaged value.
- *
- * This hook replaces the call instruction which would call
- * PlayerAVOGetCurrent() with a call to our reimplemented
- * PlayerAVOGetCurrent_Original().
- */
-static const CodeSignature kDisplayTrueSkillLevel_PatchSig(
-    /* name */       "DisplayTrueSkillLevel",
-    /* enabled */    []() { return settings.IsSkillFormulaCapEnabled(); },
-    /* hook_type */  HookType::Jump6,
-    /* hook */       reinterpret_cast<uintptr_t>(DisplayTrueSkillLevel_Hook),
-    /* id */         52525,
-    /* patch_size */ 7,
-    /* trampoline */ &DisplayTrueSkillLevel_ReturnTrampoline,
-    /* offset */     0x120
-);
-
-/**
- * @brief Overwrites the skill color displays call to PlayerAVOGetCurrent to
- *        call the original function.
- * 
- * This patch exists for the same reason as the above patch, except its concern
- * is in getting the skill number to display as the correct color, not number.
- */
-static const CodeSignature kDisplayTrueSkillColor_PatchSig(
-    /* name */       "DisplayTrueSkillColor",
-    /* enabled */    []() { return settings.IsSkillFormulaCapEnabled(); },
-    /* hook_type */  HookType::Call6,
-    /* hook */       reinterpret_cast<uintptr_t>(DisplayTrueSkillColor_Hook),
-    /* id */         52945,
-    /* patch_size */ 10,
-    /* trampoline */ nullptr,
-    /* offset */     0x32
-);
-
-/**
- * @brief Prevents the skill training function from applying our multipliers.
- */
-static const CodeSignature kImproveSkillByTraining_PatchSig(
-    /* name */       "ImproveSkillByTraining",
-    /* enabled */    []() { return settings.IsSkillExpEnabled(); },
-    /* hook_type */  HookType::Call5,
-    /* hook */       reinterpret_cast<uintptr_t>(ImprovePlayerSkillPoints_Original),
-    /* id */         41562,
-    /* patch_size */ 5,
-    /* trampoline */ nullptr,
-    /* offset */     0x98
-);
-
-/**
- * @brief Applies the multipliers from the INI file to skill experience.
- */
-static const CodeSignature kImprovePlayerSkillPoints_PatchSig(
-    /* name */       "ImprovePlayerSkillPoints",
-    /* enabled */    []() { return settings.IsSkillExpEnabled(); },
-    /* hook_type */  HookType::Jump6,
-    /* hook */       reinterpret_cast<uintptr_t>(ImprovePlayerSkillPoints_Hook),
-    /* id */         41561,
-    /* patch_size */ 6,
-    /* trampoline */ &ImprovePlayerSkillPoints_ReturnTrampoline
-);
-
-/**
- * @brief The signature and offset used to hook into the perk pool modification
- *        routine.
- *
- * Upon entry into our hook, we run our function. We then reimplement the final
- * few instructions in the return path of the function we hooked into. This way,
- * we need only modify one instruction and can still use the RelocPatch interface.
- */
-static const CodeSignature kModifyPerkPool_PatchSig(
-    /* name */       "ModifyPerkPool",
-    /* enabled */    []() { return settings.IsPerkPointsEnabled(); },
-    /* hook_type */  HookType::Jump6,
-    /* hook */       reinterpret_cast<uintptr_t>(ModifyPerkPool_Wrapper),
-    /* id */         52538,
-    /* patch_size */ 9,
-    /* trampoline */ &ModifyPerkPool_ReturnTrampoline,
-    /* offset */     0x70
-);
-
-/**
- * @brief Passes the EXP gain originally calculated by the game to our hook for
- *        further modification.
- */
-static const CodeSignature kImproveLevelExpBySkillLevel_PatchSig(
-    /* name */       "ImproveLevelExpBySkillLevel",
-    /* enabled */    []() { return settings.IsLevelExpEnabled(); },
-    /* hook_type */  HookType::Call6,
-    /* hook */       reinterpret_cast<uintptr_t>(ImproveLevelExpBySkillLevel_Wrapper),
-    /* id */         41561,
-    /* patch_size */ 8,
-    /* trampoline */ nullptr,
-    /* offset */     0x2D7
-);
-
-/**
- * @brief Overwrites the attribute level-up function to adjust the gains based
- *        on the players attribute selection.
- * 
- * We inject this patch just after the player has made their attribute selection,
- * and replace what would have been a call to player_avo->ModBase(...). Then,
- * we manually invoke ModBase and ModCurrent for the attributes and carry weight
- * as specified in the INI file.
- * 
- * Note that this patch overwrites the carry weight change done in the games code
- * as well. It also means the game settings which would usually control these
- * attributes are ignored.
- */
-static const CodeSignature kImproveAttributeWhenLevelUp_PatchSig(
-    /* name */       "ImproveAttributeWhenLevelUp",
-    /* enabled */    []() { return settings.IsAttributePointsEnabled(); },
-    /* hook_type */  HookType::Call6,
-    /* hook */       reinterpret_cast<uintptr_t>(ImproveAttributeWhenLevelUp_Hook),
-    /* id */         51917,
-    /* patch_size */ 0x2b,
-    /* trampoline */ nullptr,
-    /* offset */     0x93
-);
-
-/**
- * @brief Alters the reset level of legendarying a skill.
- *
- * Unfortunately, Kasplat has no idea why altering this particular jump makes
- * the change we want.
- */
-static const CodeSignature kLegendaryResetSkillLevel_PatchSig(
-    /* name */       "LegendaryResetSkillLevel",
-    /* enabled */    []() { return settings.IsLegendaryEnabled(); },
-    /* hook_type */  HookType::Call6,
-    /* hook */       reinterpret_cast<uintptr_t>(LegendaryResetSkillLevel_Wrapper),
-    /* id */         52591,
-    /* patch_size */ 6,
-    /* trampoline */ nullptr,
-    /* offset */     0x1d7
-);
-
-/**
- * @brief Replaces the call to the legendary condition function with our own.
- *
- * This patch simply overwrites the call to the original legendary condition
- * check function with a call to our own reimplemented condition check function.
- */
-static const CodeSignature kCheckConditionForLegendarySkill_PatchSig(
-    /* name */       "CheckConditionForLegendarySkill",
-    /* enabled */    []() { return settings.IsLegendaryEnabled(); },
-    /* hook_type */  HookType::Jump6,
-    /* hook */       reinterpret_cast<uintptr_t>(CheckConditionForLegendarySkill_Wrapper),
-    /* id */         52520,
-    /* patch_size */ 10,
-    /* trampoline */ &CheckConditionForLegendarySkill_ReturnTrampoline,
-    /* offset */     0x157
-);
-
-/**
- * @brief Hooks into the legendary button display code to allow it to be hidden.
- *
- * The assembly for this hook is as follows:
- * 48 8b 0d 2e d4 6b 02 	mov    0x26bd42e(%rip),%rcx        # 0x142fc1b78 (player)
- * 48 81 c1 b8 00 00 00 	add    $0xb8,%rcx <- Player actor state
- * 48 8b 01             	mov    (%rcx),%rax
- * 41 8b d7             	mov    %r15d,%edx <- Skill ID.
- * ff 50 18             	callq  *0x18(%rax)
- * 0f 2f 05 bf 57 d1 00 	comiss 0xd157bf(%rip),%xmm0        # 0x141619f20
- * 72 6b                	jb     0x1409047ce
- * 48 8d 05 d6 b9 e9 00 	lea    0xe9b9d6(%rip),%rax        # 0x1417a0140
- * 48 89 85 c0 00 00 00 	mov    %rax,0xc0(%rbp)
- * 48 8d 3d 58 99 c2 ff 	lea    -0x3d66a8(%rip),%rdi
-*/
-static const CodeSignature kHideLegendaryButton_PatchSig(
-    /* name */       "HideLegendaryButton",
-    /* enabled */    []() { return settings.IsLegendaryEnabled(); },
-    /* hook_type */  HookType::Jump6,
-    /* hook */       reinterpret_cast<uintptr_t>(HideLegendaryButton_Wrapper),
-    /* id */         52527,
-    /* patch_size */ 10,
-    /* trampoline */ &HideLegendaryButton_ReturnTrampoline,
-    /* offset */     0x167
-);
+ * Signatures which were not found when the cache was written are set to 0.
+ *
+ * @param real_addrs Returns the found addresses, in the same order as
+ *                   kGameSignatures.
+ * @param cache_path The path of the offset cache.
+ * @param key The key the cache must match.
+ * @return True if the cache was valid, false otherwise.
+ */
+static bool
+ReadCachedSignatures(
+    uintptr_t real_addrs[kNumSigs],
+    const std::string &cache_path,
+    const OffsetCacheKey &key
+) {
+    uintptr_t offsets[kNumSigs];
+    if (!ReadOffsetCache(cache_path, key, offsets, kNumSigs)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < kNumSigs; i++) {
+        real_addrs[i] = offsets[i]
+            ? (RelocationManager::s_baseAddr + offsets[i]) : 0;
+    }
+
+    return true;
+}
 
 /**
- * @brief Lists all the code signatures to be resolved/applied
- *        by ApplyGamePatches().
+ * @brief Finds every signature in the address library.
+ *
+ * This may run before the config has been read, so every signature is looked
+ * up regardless of whether it is enabled. Nothing is logged.
+ *
+ * @param real_addrs Returns the found addresses, in the same order as
+ *                   kGameSignatures. Signatures which could not be found are
+ *                   set to 0.
+ * @param load_ms Returns the time taken to load the address library.
+ * @param locate_ms Returns the time taken to look up the signatures.
+ * @return True if the address library could be loaded, false otherwise.
  */
-///@{
-static const CodeSignature *const kGameSignatures[] = {
-    &kThePlayer_ObjectSig,
-    &kGameSettingCollection_ObjectSig,
-    &kGetLevel_FunctionSig,
-    &kGetGameSetting_FunctionSig,
-    &kPlayerAVOGetBase_FunctionSig,
-    &kPlayerAVOGetCurrent_FunctionSig,
-    &kPlayerAVOModBase_FunctionSig,
-    &kPlayerAVOModCurrent_FunctionSig,
-
-    &kSkillCapPatch_PatchSig,
-    &kCalculateChargePointsPerUse_PatchSig,
-    &kPlayerAVOGetCurrent_PatchSig,
-    &kDisplayTrueSkillLevel_PatchSig,
-    &kDisplayTrueSkillColor_PatchSig,
-
-    &kImproveSkillByTraining_PatchSig,
-    &kImprovePlayerSkillPoints_PatchSig,
-    &kModifyPerkPool_PatchSig,
-    &kImproveLevelExpBySkillLevel_PatchSig,
-    &kImproveAttributeWhenLevelUp_PatchSig,
-
-    &kLegendaryResetSkillLevel_PatchSig,
-    &kCheckConditionForLegendarySkill_PatchSig,
-    &kHideLegendaryButton_PatchSig,
+static bool
+ResolveSignatures(
+    uintptr_t real_addrs[kNumSigs],
+    double &load_ms,
+    double &locate_ms
+) {
+    // Only the IDs we use are kept from the database, unless we need to do a
+    // reverse lookup on a known offset.
+    PhaseTimer load_timer;
+    auto db = VersionDb();
+#ifdef _DEBUG
+    bool loaded = db.Load();
+#else
+    unsigned long long ids[kNumSigs];
+    for (size_t i = 0; i < kNumSigs; i++) {
+        ids[i] = kGameSignatures[i].id;
+    }
+    bool loaded = db.Load(ids, kNumSigs);
+#endif
+    load_ms = load_timer.ElapsedMs();
+
+    if (!loaded) {
+        return false;
+    }
+
+    PhaseTimer locate_timer;
+    for (size_t i = 0; i < kNumSigs; i++) {
+        const CodeSignature *sig = &kGameSignatures[i];
+        unsigned long long id = sig->id;
+
+#ifdef _DEBUG
+        if (sig->known_offset) {
+            ASSERT(db.FindIdByOffset(sig->known_offset, id));
+        }
+#endif
+
+        void *addr = db.FindAddressById(id);
+        real_addrs[i] = addr ? (reinterpret_cast<uintptr_t>(addr) + sig->offset) : 0;
+    }
+    locate_ms = locate_timer.ElapsedMs();
+
+    return true;
+}
+
+/// @brief The result of finding the signatures off of the main thread. The
+///        worker can't log, so it leaves its timings here.
+struct SignatureLookup {
+    bool loaded;
+    bool from_cache;
+    bool cache_written;
+    double load_ms;
+    double locate_ms;
+    double total_ms;
+    uintptr_t real_addrs[kNumSigs];
 };
-static const size_t kNumSigs = sizeof(kGameSignatures) / sizeof(void*);
-///@}
 
-/// @brief The opcode for an x86 NOP.
-static const uint8_t kNop = 0x90;
+/// @brief The pending signature lookup started by LocateGamePatches().
+static std::future<SignatureLookup> pendingLookup;
 
-/// @brief The running version of skyrim.
-static unsigned int runningSkyrimVersion;
+/// @brief The path of the signature offset cache.
+static std::string offsetCachePath;
 
 /**
-* @brief Gets the actor value owner field of the player.
-*
-* The location of this field is dependent on the running version of the game.
-* As such, we must case on that.
-*
-* Versions before 1.6.629 store it at offset 0xB0. From that version on, it
-* is at offset 0xB8.
-*
-* @return The actor value owner of the player.
-*/
-static void *
-GetPlayerActorValueOwner() {
-    ASSERT(playerObject);
-    ASSERT(*playerObject);
+ * @brief Finds every signature, using the offset cache when possible.
+ *
+ * The offsets found on a previous launch are reused if the game, address
+ * library, and signature table are all unchanged. Otherwise, they are
+ * resolved through the address library and the cache is rewritten.
+ *
+ * This is run on a worker thread, and so must not log or read the config.
+ *
+ * @param cache_path The path of the signature offset cache.
+ * @return The result of the lookup.
+ */
+static SignatureLookup
+FindSignatures(
+    const std::string &cache_path
+) {
+    PhaseTimer timer;
+    SignatureLookup lookup = {};
+
+    OffsetCacheKey key;
+    bool have_key = MakeOffsetCacheKey(key);
+
+    if (have_key && ReadCachedSignatures(lookup.real_addrs, cache_path, key)) {
+        lookup.loaded = true;
+        lookup.from_cache = true;
+    } else if (ResolveSignatures(lookup.real_addrs, lookup.load_ms, lookup.locate_ms)) {
+        uintptr_t offsets[kNumSigs];
+        for (size_t i = 0; i < kNumSigs; i++) {
+            offsets[i] = lookup.real_addrs[i]
+                ? (lookup.real_addrs[i] - RelocationManager::s_baseAddr) : 0;
+        }
 
-    size_t avo_offset = (runningSkyrimVersion >= RUNTIME_VERSION_1_6_629)
-        ? 0xB8 : 0xB0;
-    return reinterpret_cast<char*>(*playerObject) + avo_offset;
+        lookup.loaded = true;
+        lookup.cache_written = have_key
+            && WriteOffsetCache(cache_path, key, offsets, kNumSigs);
+    }
+
+    lookup.total_ms = timer.ElapsedMs();
+    return lookup;
 }
 
 /**
- * @brief Locates all the signatures necessary for this plugin, and calculates
- *        the needed size of the branch trampoline buffer.
- * @param real_addrs A list of found address signatures, in the same order as
- *                   kGameSignatures.
+ * @brief Checks that every enabled signature was found, and calculates the
+ *        needed size of the hook arena.
+ * @param lookup The joined signature lookup.
  * @return The size of the buffer on success, or a negative integer on failure.
  */
 static ptrdiff_t
-LocateSignatures(
-    uintptr_t real_addrs[kNumSigs]
+CheckSignatures(
+    const SignatureLookup &lookup
 ) {
-    _MESSAGE("Attempting to locate signatures.");
+    if (!lookup.loaded) {
+        _MESSAGE("Failed to load the address library database.");
+        return -1;
+    }
 
-    auto db = VersionDb();
-    db.Load();
+    if (lookup.from_cache) {
+        _MESSAGE("Using cached signature offsets from %s.", offsetCachePath.c_str());
+    } else {
+        PhaseTimer::Log("VersionDb::Load", lookup.load_ms);
+        PhaseTimer::Log("LocateSignatures", lookup.locate_ms);
+        if (!lookup.cache_written) {
+            _MESSAGE("Could not write the signature offset cache.");
+        }
+    }
+    PhaseTimer::Log("FindSignatures (worker)", lookup.total_ms);
 
-    // Attempt to find all the requested signatures.
-    int success = 0;
-    size_t branch_alloc_size = 0;
+    bool success = true;
+    size_t arena_size = 0;
     for (size_t i = 0; i < kNumSigs; i++) {
-        auto sig = kGameSignatures[i];
-        unsigned long long id = sig->id;
+        const CodeSignature *sig = &kGameSignatures[i];
 
-        // If the patch is disabled, ignore it.
         if (sig->Disabled()) {
             _MESSAGE("Signature %s is disabled.", sig->name);
-            real_addrs[i] = 0;
             continue;
         }
 
-        // Update the branch allocation size.
-        branch_alloc_size += HookType::AllocSize(sig->hook_type);
-
-#ifdef _DEBUG
-        if (sig->known_offset) {
-            ASSERT(db.FindIdByOffset(sig->known_offset, id));
-        }
-#endif
-
-        // Find the offset.
-        void *addr = db.FindAddressById(id);
-        if (addr) {
-            real_addrs[i] = reinterpret_cast<uintptr_t>(addr) + sig->offset;
-
-            _MESSAGE(
-                "Signature %s ([ID: %zu] + 0x%zx) is at offset 0x%zx.",
-                sig->name,
-                id,
-                sig->offset,
-                real_addrs[i] - RelocationManager::s_baseAddr
-            );
-        } else {
-            success = -1;
+        if (!lookup.real_addrs[i]) {
+            success = false;
             _MESSAGE(
-                "Failed to find signature %s ([ID: %zu] + 0x%zu).",
+                "Failed to find signature %s ([ID: %zu] + 0x%zx).",
                 sig->name,
-                id,
+                sig->id,
                 sig->offset
             );
+            continue;
         }
+
+        // Update the arena size.
+        arena_size += sig->alloc_size;
+
+        _MESSAGE(
+            "Signature %s ([ID: %zu] + 0x%zx) is at offset 0x%zx.",
+            sig->name,
+            sig->id,
+            sig->offset,
+            lookup.real_addrs[i] - RelocationManager::s_baseAddr
+        );
     }
 
-    if (success < 0) {
+    if (!success) {
         _MESSAGE("Could not locate every signature.");
         return -1;
     }
 
     _MESSAGE("Successfully located all signatures.");
 
-    return branch_alloc_size;
+    return arena_size;
 }
 
 /**
-* @brief Applies the necessary game patches to the found real addresses.
-* @param The real addresses of the patches.
-*/
+ * @brief Queues a rel32 jump/call from src to dst.
+ * @param op The opcode of the branch (0xE8 for call, 0xE9 for jmp).
+ */
+static void
+QueueRel32Branch(
+    PatchTransaction &tx,
+    uintptr_t src,
+    uint8_t op,
+    uintptr_t dst
+) {
+    ptrdiff_t rel = static_cast<ptrdiff_t>(dst) - static_cast<ptrdiff_t>(src + 5);
+    ASSERT((rel >= INT32_MIN) && (rel <= INT32_MAX));
+
+    tx.Write<uint8_t>(src, op);
+    tx.Write<int32_t>(src + 1, static_cast<int32_t>(rel));
+}
+
+/**
+ * @brief Queues a 6-byte indirect jump/call from src through the given slot.
+ * @param modrm The ModR/M byte of the branch (0x25 for jmp, 0x15 for call).
+ */
+static void
+QueueIndirectBranch(
+    PatchTransaction &tx,
+    uintptr_t src,
+    uint8_t modrm,
+    uintptr_t slot
+) {
+    ptrdiff_t rel = static_cast<ptrdiff_t>(slot) - static_cast<ptrdiff_t>(src + 6);
+    ASSERT((rel >= INT32_MIN) && (rel <= INT32_MAX));
+
+    tx.Write<uint8_t>(src, 0xFF);
+    tx.Write<uint8_t>(src + 1, modrm);
+    tx.Write<int32_t>(src + 2, static_cast<int32_t>(rel));
+}
+
+/**
+ * @brief Allocates a 14-byte absolute jump to dst in the hook arena.
+ * @return The address of the jump.
+ */
+static uintptr_t
+AllocAbsoluteJump(
+    uintptr_t dst
+) {
+    uint8_t *thunk = reinterpret_cast<uint8_t*>(hookArena.Allocate(14));
+
+    // jmp [rip + 0]; dq dst
+    thunk[0] = 0xFF;
+    thunk[1] = 0x25;
+    *reinterpret_cast<uint32_t*>(thunk + 2) = 0;
+    *reinterpret_cast<uint64_t*>(thunk + 6) = dst;
+
+    return reinterpret_cast<uintptr_t>(thunk);
+}
+
+/**
+ * @brief Allocates an 8-byte address slot holding dst in the hook arena.
+ * @return The address of the slot.
+ */
+static uintptr_t
+AllocAddressSlot(
+    uintptr_t dst
+) {
+    uintptr_t *slot = reinterpret_cast<uintptr_t*>(hookArena.Allocate(sizeof(uintptr_t)));
+    *slot = dst;
+    return reinterpret_cast<uintptr_t>(slot);
+}
+
+/**
+ * @brief Logs the writes made by each enabled signature, and the cost of
+ *        committing them, as a single block.
+ * @param stats The writes of each signature, in the same order as
+ *              kGameSignatures.
+ * @param total The writes of every signature together.
+ * @param protect_calls The number of page protection calls made by the commit.
+ * @param ms The time taken by the commit.
+ */
 static void
+LogPatchReport(
+    const PatchTransaction::Stats stats[kNumSigs],
+    const PatchTransaction::Stats &total,
+    size_t protect_calls,
+    double ms
+) {
+    _MESSAGE("Patch report:");
+    _MESSAGE(
+        "    %-36s %6s %6s %6s %8s",
+        "Signature",
+        "Bytes",
+        "Writes",
+        "Pages",
+        "Saves"
+    );
+    for (size_t i = 0; i < kNumSigs; i++) {
+        if (kGameSignatures[i].Disabled()) {
+            continue;
+        }
+
+        _MESSAGE(
+            "    %-36s %6zu %6zu %6zu %8s",
+            kGameSignatures[i].name,
+            stats[i].bytes,
+            stats[i].writes,
+            stats[i].pages,
+            HookSave::Str(kGameSignatures[i].save)
+        );
+    }
+    _MESSAGE("    %-36s %6zu %6zu %6zu", "Total", total.bytes, total.writes, total.pages);
+    _MESSAGE(
+        "    Committed with %zu page protection calls in %.3f ms.",
+        protect_calls,
+        ms
+    );
+}
+
+/**
+ * @brief Applies the necessary game patches to the found real addresses.
+ *
+ * Every write to the game code is queued in a single transaction, so that
+ * each code page is only unprotected once.
+ *
+ * @param The real addresses of the patches.
+ * @return True if the patches were applied, false otherwise.
+ */
+static bool
 PatchGameCode(
     uintptr_t real_addrs[kNumSigs]
 ) {
     _MESSAGE("Applying game patches...");
 
+    PatchTransaction tx;
+    size_t marks[kNumSigs + 1];
+
     for (size_t i = 0; i < kNumSigs; i++) {
         uintptr_t real_address = real_addrs[i];
-        auto sig = kGameSignatures[i];
+        const CodeSignature *sig = &kGameSignatures[i];
+        marks[i] = tx.Mark();
 
         // Skip disabled patches.
         if (sig->Disabled()) {
             continue;
         }
 
-        size_t hook_size = HookType::Size(sig->hook_type);
-        size_t return_address = real_address + hook_size;
+        // A data patch covers the entire site, so there is nothing to NOP.
+        if (sig->data_patch && sig->data_patch(tx, real_address, sig->patch_size)) {
+            continue;
+        }
 
-        ASSERT(hook_size <= sig->patch_size);
-        ASSERT(!(sig->hook) == ((sig->hook_type == HookType::None)
-            || (sig->hook_type == HookType::Nop)));
+        // The table is checked at compile time, so the sizes and links of the
+        // signature are known to be consistent here.
+        size_t return_address = real_address + sig->hook_size;
 
         // Install the trampoline, if necessary.
         if (sig->return_trampoline) {
-            ASSERT(sig->hook_type != HookType::None);
-            ASSERT(sig->hook_type != HookType::Nop);
             *(sig->return_trampoline) = return_address;
         }
 
         // Install the hook/result.
         switch (sig->hook_type) {
             case HookType::None:
-                ASSERT(sig->result);
-                *(sig->result) = reinterpret_cast<void*>(real_address);
+                sig->result(real_address);
                 break;
             case HookType::Jump5:
-                ASSERT(g_branchTrampoline.Write5Branch(real_address, sig->hook));
+                QueueRel32Branch(tx, real_address, 0xE9,
+                    AllocAbsoluteJump(sig->hook()));
                 break;
             case HookType::Jump6:
-                ASSERT(g_branchTrampoline.Write6Branch(real_address, sig->hook));
+                QueueIndirectBranch(tx, real_address, 0x25,
+                    AllocAddressSlot(sig->hook()));
                 break;
             case HookType::Call5:
-                ASSERT(g_branchTrampoline.Write5Call(real_address, sig->hook));
+                QueueRel32Branch(tx, real_address, 0xE8,
+                    AllocAbsoluteJump(sig->hook()));
                 break;
             case HookType::Call6:
-                ASSERT(g_branchTrampoline.Write6Call(real_address, sig->hook));
+                QueueIndirectBranch(tx, real_address, 0x15,
+                    AllocAddressSlot(sig->hook()));
                 break;
             case HookType::DirectCall:
-                ASSERT(SafeWriteCall(real_address, sig->hook));
+                QueueRel32Branch(tx, real_address, 0xE8, sig->hook());
                 break;
             case HookType::DirectJump:
-                ASSERT(SafeWriteJump(real_address, sig->hook));
+                QueueRel32Branch(tx, real_address, 0xE9, sig->hook());
                 break;
             case HookType::Nop:
                 break;
@@ -780,19 +1393,47 @@ PatchGameCode(
         // Overwrite the rest of the instructions with NOPs. We do this with
         // every hook to ensure the best compatibility with other SKSE
         // plugins.
-        SafeMemSet(return_address, kNop, sig->patch_size - hook_size);
+        tx.Fill(return_address, kNop, sig->patch_size - sig->hook_size);
+    }
+    marks[kNumSigs] = tx.Mark();
+
+    // The queued writes are gone once they have been committed.
+    PatchTransaction::Stats stats[kNumSigs];
+    for (size_t i = 0; i < kNumSigs; i++) {
+        stats[i] = tx.GetStats(marks[i], marks[i + 1]);
+    }
+    PatchTransaction::Stats total = tx.GetStats(0, marks[kNumSigs]);
+
+    PhaseTimer commit_timer;
+    if (!tx.Commit()) {
+        _ERROR("Failed to write the game patches.");
+        return false;
     }
+    LogPatchReport(stats, total, tx.ProtectCalls(), commit_timer.ElapsedMs());
 
     _MESSAGE("Finished applying game patches!");
+    return true;
 }
 
+/// @brief The names of each game setting in GameSetting::t.
+static const char *const kGameSettingNames[GameSetting::kCount] = {
+    "fEnchantingCostExponent",
+    "fEnchantingSkillCostBase",
+    "fEnchantingSkillCostScale",
+    "fEnchantingSkillCostMult",
+    "fLegendarySkillResetValue"
+};
+
+/// @brief The cached value locations of each game setting in GameSetting::t.
+static float *gameSettingCache[GameSetting::kCount];
+
 /**
- * @brief Gets a pointer to a float game setting.
+ * @brief Searches the game settings collection for a float game setting.
  *
  * Always returns a valid pointer.
  */
-float *
-GetFloatGameSetting(
+static float *
+LookupFloatGameSetting(
     const char *var
 ) {
     ASSERT(gameSettings);
@@ -804,6 +1445,36 @@ GetFloatGameSetting(
     return &setting->data.f32;
 }
 
+/**
+ * @brief Looks up and caches every game setting used by our hooks.
+ *
+ * Must only be called once the game has loaded its settings collection.
+ */
+void
+CacheGameSettings() {
+    for (int i = 0; i < GameSetting::kCount; i++) {
+        gameSettingCache[i] = LookupFloatGameSetting(kGameSettingNames[i]);
+    }
+}
+
+/**
+ * @brief Gets a pointer to a float game setting.
+ *
+ * The setting is looked up the first time it is requested, if it was not
+ * already cached by CacheGameSettings(). Always returns a valid pointer.
+ */
+float *
+GetFloatGameSetting(
+    GameSetting::t var
+) {
+    ASSERT(var < GameSetting::kCount);
+    float *ret = gameSettingCache[var];
+    if (!ret) {
+        ret = gameSettingCache[var] = LookupFloatGameSetting(kGameSettingNames[var]);
+    }
+    return ret;
+}
+
 /**
 * @brief Gets the level of the player.
 */
@@ -824,7 +1495,7 @@ PlayerAVOGetBase(
     ActorAttribute::t attr
 ) {
     ASSERT(PlayerAVOGetBase_Entry);
-    return PlayerAVOGetBase_Entry(GetPlayerActorValueOwner(), attr);
+    return PlayerAVOGetBase_Entry(GetPlayerAVO(), attr);
 }
 
 /**
@@ -842,14 +1513,15 @@ PlayerAVOGetCurrent_Original(
     ActorAttribute::t attr
 ) {
     ASSERT(PlayerAVOGetCurrent_Entry);
-    if (settings.IsSkillFormulaCapEnabled()) {
+
+    // The trampoline is only filled in when the patch is installed, so we
+    // don't need to look at the settings to know which one to call.
+    if (PlayerAVOGetCurrent_ReturnTrampoline) {
         // Patch installed, so we need to use the wrapper.
-        ASSERT(PlayerAVOGetCurrent_ReturnTrampoline);
         return PlayerAVOGetCurrent_OriginalWrapper(av, attr);
     } else {
         // No patch installed, so we can just call the original function
         // (and must, since we don't have a trampoline).
-        ASSERT(PlayerAVOGetCurrent_ReturnTrampoline == 0);
         return PlayerAVOGetCurrent_Entry(av, attr);
     }
 }
@@ -865,7 +1537,8 @@ PlayerAVOModBase(
     float val
 ) {
     ASSERT(PlayerAVOModBase_Entry);
-    PlayerAVOModBase_Entry(GetPlayerActorValueOwner(), attr, val);
+    PlayerAVOModBase_Entry(GetPlayerAVO(), attr, val);
+    InvalidatePlayerCache();
 }
 
 /**
@@ -881,45 +1554,138 @@ PlayerAVOModCurrent(
     float val
 ) {
     ASSERT(PlayerAVOModCurrent_Entry);
-    PlayerAVOModCurrent_Entry(GetPlayerActorValueOwner(), unk1, attr, val);
+    PlayerAVOModCurrent_Entry(GetPlayerAVO(), unk1, attr, val);
+}
+
+/**
+ * @brief Adds the given attribute deltas to the player.
+ *
+ * The player AVO is only looked up once, and attributes which don't change
+ * are skipped, so that the game doesn't send out change notifications for
+ * them. Health, magicka, and stamina are changed in their base value. Like the
+ * original level up code, carry weight is changed in its current value.
+ *
+ * @param level_up The deltas to add.
+ */
+void
+PlayerAVOApplyLevelUp(
+    const ActorAttributeLevelUp &level_up
+) {
+    ASSERT(PlayerAVOModBase_Entry && PlayerAVOModCurrent_Entry);
+    void *avo = GetPlayerAVO();
+
+    if (level_up.health != 0) {
+        PlayerAVOModBase_Entry(avo, ActorAttribute::Health, level_up.health);
+    }
+    if (level_up.magicka != 0) {
+        PlayerAVOModBase_Entry(avo, ActorAttribute::Magicka, level_up.magicka);
+    }
+    if (level_up.stamina != 0) {
+        PlayerAVOModBase_Entry(avo, ActorAttribute::Stamina, level_up.stamina);
+    }
+    if (level_up.carry_weight != 0) {
+        PlayerAVOModCurrent_Entry(avo, 0, ActorAttribute::CarryWeight, level_up.carry_weight);
+    }
+
+    InvalidatePlayerCache();
+}
+
+/**
+ * @brief Begins locating the signatures of this plugins patches.
+ *
+ * The lookup runs on a worker thread, since it doesn't depend on the config.
+ * This allows the config to be read while the address library is decoded.
+ * The lookup is joined by ApplyGamePatches().
+ *
+ * @param runtime_version The running version of skyrim.
+ * @param cache_path The path of the signature offset cache.
+ */
+void
+LocateGamePatches(
+    unsigned int runtime_version,
+    const std::string &cache_path
+) {
+    ASSERT(runtime_version >= RUNTIME_VERSION_1_6_317); // AE.
+    ASSERT(!pendingLookup.valid());
+
+    runningSkyrimVersion = runtime_version;
+    offsetCachePath = cache_path;
+
+    _MESSAGE("Attempting to locate signatures.");
+    pendingLookup = std::async(std::launch::async, FindSignatures, cache_path);
+}
+
+/**
+ * @brief Joins the signature lookup started by LocateGamePatches() without
+ *        patching the game.
+ *
+ * This must be called on any failure between LocateGamePatches() and
+ * ApplyGamePatches(), so that the worker isn't left running (and possibly
+ * writing the offset cache) after initialization has failed.
+ */
+void
+AbandonGamePatches() {
+    if (pendingLookup.valid()) {
+        pendingLookup.get();
+        _MESSAGE("Abandoned the signature lookup.");
+    }
 }
 
 /**
  * @brief Applies all of this plugins patches to the skyrim AE binary.
+ *
+ * LocateGamePatches() must have been called first, and the config must have
+ * been read.
+ *
  * @param img_base The base of the skyrim module.
- * @param runtime_version The running version of skyrim.
  * @return 0 if the patches could be applied, a negative integer otherwise.
  */
 int
 ApplyGamePatches(
-    void *img_base,
-    unsigned int runtime_version
+    void *img_base
 ) {
-    ASSERT(runtime_version >= RUNTIME_VERSION_1_6_317); // AE.
-    runningSkyrimVersion = runtime_version;
-
-    uintptr_t real_addrs[kNumSigs];
+    ASSERT(pendingLookup.valid());
+    PhaseTimer join_timer;
+    SignatureLookup lookup = pendingLookup.get();
+    join_timer.Log("Waiting for signatures");
 
-    size_t alloc_size = LocateSignatures(real_addrs);
+    ptrdiff_t alloc_size = CheckSignatures(lookup);
     if (alloc_size < 0) {
         return -1;
     }
 
     if (alloc_size > 0) {
         _MESSAGE(
-            "Creating a branch trampoline buffer with %zu bytes of space...",
+            "Creating a hook arena with %zu bytes of space...",
             alloc_size
         );
-        if (!g_branchTrampoline.Create(alloc_size, img_base)) {
-            _MESSAGE("Failed to allocate branch trampoline.");
+        PhaseTimer arena_timer;
+        if (!hookArena.Create(alloc_size, img_base)) {
+            _MESSAGE("Failed to allocate the hook arena.");
             return -1;
         }
-        _MESSAGE("Done!");
+        arena_timer.Log("HookArena::Create");
+        _MESSAGE(
+            "Done! The arena is 0x%zx bytes below the game image.",
+            reinterpret_cast<uintptr_t>(img_base) - hookArena.Base()
+        );
     } else {
         _MESSAGE("Everything is disabled...");
     }
 
-    PatchGameCode(real_addrs);
+    SelectHookVariants();
+
+    PhaseTimer patch_timer;
+    if (!PatchGameCode(lookup.real_addrs)) {
+        return -1;
+    }
+    patch_timer.Log("PatchGameCode");
+
+    if (alloc_size > 0) {
+        hookArena.LogUsage();
+    }
+
+    SelectPlayerLayout();
 
     return 0;
 }
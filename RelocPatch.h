@@ -1,13 +1,18 @@
 /**
  * @file RelocPatch.h
  * @author Andrew Spaulding (Kasplat)
- * @brief Exposes the function which patches the game binary.
+ * @brief Exposes the functions which patch the game binary.
  * @bug No known bugs.
  */
 
 #ifndef __SKYRIM_UNCAPPER_AE_RELOC_PATCH_H__
 #define __SKYRIM_UNCAPPER_AE_RELOC_PATCH_H__
 
-int ApplyGamePatches(void *img_base, unsigned int runtime_version);
+#include <string>
+
+void LocateGamePatches(unsigned int runtime_version,
+                       const std::string &cache_path);
+void AbandonGamePatches(void);
+int ApplyGamePatches(void *img_base);
 
 #endif /* __SKYRIM_UNCAPPER_AE_RELOC_PATCH_H__ */
@@ -0,0 +1,39 @@
+/**
+ * @file ReusableTask.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Implementation of the reusable SKSE task.
+ * @bug No known bugs.
+ */
+
+#include "ReusableTask.h"
+
+/**
+ * @brief Queues the task with SKSE, unless it is already queued.
+ * @param tasks The SKSE task interface.
+ */
+void
+ReusableTask::Queue(
+    SKSETaskInterface *tasks
+) {
+    if (!pending.exchange(true)) {
+        tasks->AddTask(this);
+    }
+}
+
+/**
+ * @brief Runs the task, allowing it to be queued again.
+ *
+ * The flag is cleared first, so a request made while the task runs queues it
+ * again instead of being lost.
+ */
+void
+ReusableTask::Run() {
+    pending.store(false);
+    Execute();
+}
+
+/**
+ * @brief Does nothing, as the task is reused.
+ */
+void
+ReusableTask::Dispose() {}
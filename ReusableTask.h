@@ -0,0 +1,41 @@
+/**
+ * @file ReusableTask.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes an SKSE task which is queued at most once at a time.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_REUSABLE_TASK_H__
+#define __SKYRIM_UNCAPPER_AE_REUSABLE_TASK_H__
+
+#include <atomic>
+
+#include "PluginAPI.h"
+#include "gamethreads.h"
+
+/**
+ * @brief A task which runs on the main thread, and which may be queued from
+ *        any thread.
+ *
+ * Queuing the task while it is already queued does nothing, so it runs once
+ * for any number of requests made before it gets to run. Instances are meant
+ * to be static and are handed to SKSE over and over, so they are never freed.
+ */
+class ReusableTask : public TaskDelegate {
+  private:
+    std::atomic<bool> pending;
+
+  protected:
+    /// @brief Does the work of the task on the main thread.
+    virtual void Execute(void) = 0;
+
+  public:
+    ReusableTask() : pending(false) {}
+
+    void Queue(SKSETaskInterface *tasks);
+
+    virtual void Run();
+    virtual void Dispose();
+};
+
+#endif /* __SKYRIM_UNCAPPER_AE_REUSABLE_TASK_H__ */
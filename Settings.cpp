@@ -9,13 +9,40 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+#include <Windows.h>
 
 #include "Settings.h"
 #include "Compare.h"
 #include "Utilities.h"
 
 /// @brief Global settings manager, used throughout this plugin.
-Settings settings;
+alignas(64) std::atomic<const Settings*> activeSettings;
+
+/// @brief The current reclamation epoch. Epoch 0 means "not reading".
+alignas(64) std::atomic<uint64_t> settingsEpoch(1);
+
+/// @brief Every epoch slot which has been created.
+static std::atomic<SettingsEpochSlot*> allEpochSlots;
+
+thread_local SettingsEpochSlot *threadEpochSlot;
+
+/// @brief Settings which have been replaced, along with the epoch they were
+///        replaced in.
+static std::vector<std::pair<const Settings*, uint64_t>> retiredSettings;
+
+/// @brief Serializes the publishing of new settings.
+static std::mutex publishLock;
+
+alignas(64) float SkillCapTable[SkillSlot::kCount];
+float *SkillCapDirectSlot = nullptr;
+
+// SkillCapPatch_Wrapper indexes the table by hand.
+static_assert(SkillSlot::kCount == 18, "HookWrappers.asm expects 18 skills");
+static_assert(ActorAttribute::OneHanded == 6, "HookWrappers.asm expects skills to start at 6");
 
 // Comment on each leveled setting description.
 #define LEVELED_SETTING_NOTE\
@@ -43,6 +70,15 @@ const char *const Settings::GeneralSettings::kEnableAttributePointsDesc =
     "# Enables the code which modifies attribute point gain.";
 const char *const Settings::GeneralSettings::kEnableLegendaryDesc =
     "# Enables the code which modifies the legendary skill system.";
+const char *const Settings::GeneralSettings::kEnableConfigHotReloadDesc =
+    "# Reloads this file while the game is running whenever it is saved.\n"
+    "# Changes to the options above this one still require a restart.";
+const char *const Settings::GeneralSettings::kInterpolateExpMultsDesc =
+    "# Treats the levels given in the CharacterLevel and BaseSkillLevel\n"
+    "# subsections of SkillExpGainMults and LevelSkillExpMults as points on a\n"
+    "# curve. Levels between two points get a value on the straight line\n"
+    "# between them, rather than the value of the lower point. Levels after\n"
+    "# the last point still use its value.";
 
 const char *const Settings::EnchantSettings::kSection = "Enchanting";
 const char *const Settings::EnchantSettings::kMagnitudeLevelCapDesc =
@@ -56,7 +92,8 @@ const char *const Settings::EnchantSettings::kUseLinearChargeFormulaDesc =
     "# Forces the game to use a linear formula for level-based weapon\n"
     "# charge calculation. Useful if the charge cap is close to 199, as the\n"
     "# later level-ups in enchanting will give massive boosts to the number\n"
-    "# of charge points available.";
+    "# of charge points available.\n"
+    "# Changing this option requires a restart.";
 
 const char *const Settings::LegendarySettings::kSection = "LegendarySkill";
 const char *const Settings::LegendarySettings::kKeepSkillLevelDesc =
@@ -165,6 +202,8 @@ Settings::GeneralSettings::ReadConfig(
     enablePerkPoints.ReadConfig(ini, kSection);
     enableAttributePoints.ReadConfig(ini, kSection);
     enableLegendary.ReadConfig(ini, kSection);
+    enableConfigHotReload.ReadConfig(ini, kSection);
+    interpolateExpMults.ReadConfig(ini, kSection);
 }
 
 /**
@@ -172,7 +211,7 @@ Settings::GeneralSettings::ReadConfig(
  */
 void
 Settings::GeneralSettings::SaveConfig(
-    CSimpleIniA &ini
+    IniWriter &ini
 ) {
     version.SaveConfig(ini, kSection, kVersionDesc);
     author.SaveConfig(ini, kSection, NULL);
@@ -184,6 +223,100 @@ Settings::GeneralSettings::SaveConfig(
     enablePerkPoints.SaveConfig(ini, kSection, kEnablePerkPointsDesc);
     enableAttributePoints.SaveConfig(ini, kSection, kEnableAttributePointsDesc);
     enableLegendary.SaveConfig(ini, kSection, kEnableLegendaryDesc);
+    enableConfigHotReload.SaveConfig(ini, kSection, kEnableConfigHotReloadDesc);
+    interpolateExpMults.SaveConfig(ini, kSection, kInterpolateExpMultsDesc);
+}
+
+/**
+ * @brief Sets the version to the current one, and replaces it in the file
+ *        being merged into.
+ * @return True if the version was replaced, false if the file must be
+ *         rewritten instead.
+ */
+bool
+Settings::GeneralSettings::MergeVersion(
+    IniWriter &ini
+) {
+    char buf[16];
+    auto res = std::to_chars(buf, buf + sizeof(buf) - 1, CONFIG_VERSION);
+    ASSERT(res.ec == std::errc());
+    *res.ptr = '\0';
+
+    version.Set(CONFIG_VERSION);
+    return ini.OverwriteValue(kSection, version.GetName(), buf);
+}
+
+/**
+ * @brief Replaces the enable flags of this section with the installed ones.
+ *
+ * Any flag which differs is logged, as changing it requires a restart.
+ */
+void
+Settings::GeneralSettings::KeepInstalledPatches(
+    const GeneralSettings &installed
+) {
+    SectionField<bool> GeneralSettings::*const kFlags[] = {
+        &GeneralSettings::enableSkillCaps,
+        &GeneralSettings::enableSkillFormulaCaps,
+        &GeneralSettings::enableEnchantingPatch,
+        &GeneralSettings::enableSkillExpMults,
+        &GeneralSettings::enableLevelExpMults,
+        &GeneralSettings::enablePerkPoints,
+        &GeneralSettings::enableAttributePoints,
+        &GeneralSettings::enableLegendary,
+        &GeneralSettings::enableConfigHotReload
+    };
+
+    for (auto flag : kFlags) {
+        bool installed_val = (installed.*flag).Get();
+        if ((this->*flag).Get() != installed_val) {
+            _MESSAGE("Changing %s requires restarting the game.", (this->*flag).GetName());
+            (this->*flag).Set(installed_val);
+        }
+    }
+}
+
+/**
+ * @brief Writes the general settings section to the given settings cache.
+ */
+void
+Settings::GeneralSettings::WriteCache(
+    SettingsCacheWriter &cache
+) const {
+    version.WriteCache(cache);
+    author.WriteCache(cache);
+    enableSkillCaps.WriteCache(cache);
+    enableSkillFormulaCaps.WriteCache(cache);
+    enableEnchantingPatch.WriteCache(cache);
+    enableSkillExpMults.WriteCache(cache);
+    enableLevelExpMults.WriteCache(cache);
+    enablePerkPoints.WriteCache(cache);
+    enableAttributePoints.WriteCache(cache);
+    enableLegendary.WriteCache(cache);
+    enableConfigHotReload.WriteCache(cache);
+    interpolateExpMults.WriteCache(cache);
+}
+
+/**
+ * @brief Reads the general settings section from the given settings cache.
+ * @return True if the section was read, false otherwise.
+ */
+bool
+Settings::GeneralSettings::ReadCache(
+    SettingsCacheReader &cache
+) {
+    return version.ReadCache(cache)
+        && author.ReadCache(cache)
+        && enableSkillCaps.ReadCache(cache)
+        && enableSkillFormulaCaps.ReadCache(cache)
+        && enableEnchantingPatch.ReadCache(cache)
+        && enableSkillExpMults.ReadCache(cache)
+        && enableLevelExpMults.ReadCache(cache)
+        && enablePerkPoints.ReadCache(cache)
+        && enableAttributePoints.ReadCache(cache)
+        && enableLegendary.ReadCache(cache)
+        && enableConfigHotReload.ReadCache(cache)
+        && interpolateExpMults.ReadCache(cache);
 }
 
 /**
@@ -203,13 +336,55 @@ Settings::EnchantSettings::ReadConfig(
  */
 void
 Settings::EnchantSettings::SaveConfig(
-    CSimpleIniA &ini
+    IniWriter &ini
 ) {
     magnitudeLevelCap.SaveConfig(ini, kSection, kMagnitudeLevelCapDesc);
     chargeLevelCap.SaveConfig(ini, kSection, kChargeLevelCapDesc);
     useLinearChargeFormula.SaveConfig(ini, kSection, kUseLinearChargeFormulaDesc);
 }
 
+/**
+ * @brief Writes the enchant settings section to the given settings cache.
+ */
+void
+Settings::EnchantSettings::WriteCache(
+    SettingsCacheWriter &cache
+) const {
+    magnitudeLevelCap.WriteCache(cache);
+    chargeLevelCap.WriteCache(cache);
+    useLinearChargeFormula.WriteCache(cache);
+}
+
+/**
+ * @brief Reads the enchant settings section from the given settings cache.
+ * @return True if the section was read, false otherwise.
+ */
+bool
+Settings::EnchantSettings::ReadCache(
+    SettingsCacheReader &cache
+) {
+    return magnitudeLevelCap.ReadCache(cache)
+        && chargeLevelCap.ReadCache(cache)
+        && useLinearChargeFormula.ReadCache(cache);
+}
+
+/**
+ * @brief Replaces the charge formula of this section with the installed one.
+ *
+ * The patcher installs a separate charge hook for each formula, so changing
+ * it requires a restart.
+ */
+void
+Settings::EnchantSettings::KeepInstalledPatches(
+    const EnchantSettings &installed
+) {
+    bool installed_val = installed.useLinearChargeFormula.Get();
+    if (useLinearChargeFormula.Get() != installed_val) {
+        _MESSAGE("Changing %s requires restarting the game.", useLinearChargeFormula.GetName());
+        useLinearChargeFormula.Set(installed_val);
+    }
+}
+
 /**
  * @brief Reads in the legendary skill settings section.
  */
@@ -228,7 +403,7 @@ Settings::LegendarySettings::ReadConfig(
  */
 void
 Settings::LegendarySettings::SaveConfig(
-    CSimpleIniA &ini
+    IniWriter &ini
 ) {
     keepSkillLevel.SaveConfig(ini, kSection, kKeepSkillLevelDesc);
     hideButton.SaveConfig(ini, kSection, kHideButtonDesc);
@@ -237,22 +412,42 @@ Settings::LegendarySettings::SaveConfig(
 }
 
 /**
- * @brief Saves the given INI file to the given path.
- * @param ini The INI file to be saved.
- * @param path The path to save the file to.
+ * @brief Writes the legendary skill settings section to the given settings
+ *        cache.
+ */
+void
+Settings::LegendarySettings::WriteCache(
+    SettingsCacheWriter &cache
+) const {
+    keepSkillLevel.WriteCache(cache);
+    hideButton.WriteCache(cache);
+    skillLevelEnable.WriteCache(cache);
+    skillLevelAfter.WriteCache(cache);
+}
+
+/**
+ * @brief Reads the legendary skill settings section from the given settings
+ *        cache.
+ * @return True if the section was read, false otherwise.
  */
 bool
-Settings::SaveConfig(
-    CSimpleIniA &ini,
-    const std::string &path
+Settings::LegendarySettings::ReadCache(
+    SettingsCacheReader &cache
 ) {
-    _MESSAGE("Saving config file...");
-
-    // Clear the INI file; we will rewrite it.
-    ini.Reset();
+    return keepSkillLevel.ReadCache(cache)
+        && hideButton.ReadCache(cache)
+        && skillLevelEnable.ReadCache(cache)
+        && skillLevelAfter.ReadCache(cache);
+}
 
-    // Reset the general information.
-    general.version.Set(CONFIG_VERSION);
+/**
+ * @brief Writes every setting to the given INI writer, in the order they
+ *        appear in the file.
+ */
+void
+Settings::WriteConfig(
+    IniWriter &ini
+) {
     general.SaveConfig(ini);
     skillCaps.SaveConfig(ini, kSkillCapsDesc);
     skillFormulaCaps.SaveConfig(ini, kSkillFormulaCapsDesc);
@@ -277,11 +472,31 @@ Settings::SaveConfig(
     carryWeightAtMagickaLevelUp.SaveConfig(ini, kCarryWeightAtMagickaLevelUpDesc);
     carryWeightAtStaminaLevelUp.SaveConfig(ini, kCarryWeightAtStaminaLevelUpDesc);
     legendary.SaveConfig(ini);
+}
 
-    // Save the generated INI file.
-    SI_Error er = ini.SaveFile(path.c_str());
-    if (er < SI_OK) {
-        _ERROR("Can't save config file ret:%d errno:%d", (int)er,  errno);
+/**
+ * @brief Writes the current settings out to an INI file at the given path.
+ * @param path The path to save the file to.
+ */
+bool
+Settings::SaveConfig(
+    const std::string &path
+) {
+    _MESSAGE("Saving config file...");
+
+    IniWriter ini;
+    if (!ini.Open(path)) {
+        _ERROR("Can't create config file errno:%d", errno);
+        return false;
+    }
+
+    // Reset the general information.
+    general.version.Set(CONFIG_VERSION);
+    WriteConfig(ini);
+
+    // Flush out the rest of the file.
+    if (!ini.Close()) {
+        _ERROR("Can't save config file errno:%d", errno);
         return false;
     } else {
         _MESSAGE("Config file saved.");
@@ -289,9 +504,155 @@ Settings::SaveConfig(
     }
 }
 
+/**
+ * @brief Updates an outdated INI file by adding only the settings it is
+ *        missing.
+ *
+ * The version is replaced where it is, and every new setting is appended to
+ * the end of the file along with its description. Nothing else in the file
+ * is touched, so any formatting or comments the user added are kept.
+ *
+ * @param ini The loaded content of the file.
+ * @param path The path of the file.
+ * @return True if the file was updated, false if it must be rewritten. In the
+ *         latter case, the file is unchanged.
+ */
+bool
+Settings::MergeConfig(
+    const CSimpleIniA &ini,
+    const std::string &path
+) {
+    _MESSAGE("Merging new settings into config file...");
+
+    IniWriter writer;
+    if (!writer.OpenMerge(path, ini)) {
+        _WARNING("Can't open config file errno:%d", errno);
+        return false;
+    }
+
+    // The new version must be as long as the old one to be replaced in place.
+    if (!general.MergeVersion(writer)) {
+        _MESSAGE("Config file version can't be replaced in place.");
+        writer.Close();
+        return false;
+    }
+
+    WriteConfig(writer);
+
+    if (!writer.Close()) {
+        _ERROR("Can't save config file errno:%d", errno);
+        return false;
+    }
+
+    _MESSAGE("Added %zu new settings to the config file.", writer.Count());
+    return true;
+}
+
+/**
+ * @brief Writes every setting to the given settings cache.
+ *
+ * Settings are written in the same order they are read from the INI.
+ */
+void
+Settings::WriteCache(
+    SettingsCacheWriter &cache
+) const {
+    general.WriteCache(cache);
+    skillCaps.WriteCache(cache);
+    skillFormulaCaps.WriteCache(cache);
+    enchant.WriteCache(cache);
+    skillExpGainMults.WriteCache(cache);
+    skillExpGainMultsWithSkills.WriteCache(cache);
+    skillExpGainMultsWithPCLevel.WriteCache(cache);
+    levelSkillExpMults.WriteCache(cache);
+    levelSkillExpMultsWithSkills.WriteCache(cache);
+    levelSkillExpMultsWithPCLevel.WriteCache(cache);
+    perksAtLevelUp.WriteCache(cache);
+    healthAtLevelUp.WriteCache(cache);
+    healthAtMagickaLevelUp.WriteCache(cache);
+    healthAtStaminaLevelUp.WriteCache(cache);
+    magickaAtLevelUp.WriteCache(cache);
+    magickaAtHealthLevelUp.WriteCache(cache);
+    magickaAtStaminaLevelUp.WriteCache(cache);
+    staminaAtLevelUp.WriteCache(cache);
+    staminaAtHealthLevelUp.WriteCache(cache);
+    staminaAtMagickaLevelUp.WriteCache(cache);
+    carryWeightAtHealthLevelUp.WriteCache(cache);
+    carryWeightAtMagickaLevelUp.WriteCache(cache);
+    carryWeightAtStaminaLevelUp.WriteCache(cache);
+    legendary.WriteCache(cache);
+}
+
+/**
+ * @brief Reads every setting from the given settings cache.
+ *
+ * If this fails, the settings are left partially read and must be read from
+ * the INI instead.
+ *
+ * @return True if every setting was read, false otherwise.
+ */
+bool
+Settings::ReadCache(
+    SettingsCacheReader &cache
+) {
+    bool ok = general.ReadCache(cache)
+        && skillCaps.ReadCache(cache)
+        && skillFormulaCaps.ReadCache(cache)
+        && enchant.ReadCache(cache)
+        && skillExpGainMults.ReadCache(cache)
+        && skillExpGainMultsWithSkills.ReadCache(cache)
+        && skillExpGainMultsWithPCLevel.ReadCache(cache)
+        && levelSkillExpMults.ReadCache(cache)
+        && levelSkillExpMultsWithSkills.ReadCache(cache)
+        && levelSkillExpMultsWithPCLevel.ReadCache(cache)
+        && perksAtLevelUp.ReadCache(cache)
+        && healthAtLevelUp.ReadCache(cache)
+        && healthAtMagickaLevelUp.ReadCache(cache)
+        && healthAtStaminaLevelUp.ReadCache(cache)
+        && magickaAtLevelUp.ReadCache(cache)
+        && magickaAtHealthLevelUp.ReadCache(cache)
+        && magickaAtStaminaLevelUp.ReadCache(cache)
+        && staminaAtLevelUp.ReadCache(cache)
+        && staminaAtHealthLevelUp.ReadCache(cache)
+        && staminaAtMagickaLevelUp.ReadCache(cache)
+        && carryWeightAtHealthLevelUp.ReadCache(cache)
+        && carryWeightAtMagickaLevelUp.ReadCache(cache)
+        && carryWeightAtStaminaLevelUp.ReadCache(cache)
+        && legendary.ReadCache(cache)
+        && cache.Done();
+
+    if (ok) {
+        ApplyExpInterpolation();
+        BuildFormulaClamps();
+        BuildAttributeLevelUps();
+    }
+    return ok;
+}
+
+/**
+ * @brief Creates the settings cache key for the INI at the given path.
+ * @return True if the key was created, false if the INI could not be found.
+ */
+static bool
+GetConfigCacheKey(
+    const std::string &path,
+    SettingsCacheKey &key
+) {
+    if (!GetSettingsCacheKey(path, key)) {
+        return false;
+    }
+
+    key.config_version = CONFIG_VERSION;
+    return true;
+}
+
 /**
  * @brief Loads in the INI configuration from the given path.
  *
+ * If the INI has not changed since it was last parsed, the settings are read
+ * back from the settings cache next to it instead. Otherwise, the INI is
+ * parsed and the cache is rewritten.
+ *
  * If the given file does not exist, the INI will be created with the default
  * settings at the specified location.
  *
@@ -300,18 +661,59 @@ Settings::SaveConfig(
 bool
 Settings::ReadConfig(
     const std::string &path
+) {
+    const std::string cache_path = path + ".cache";
+    SettingsCacheKey key;
+    std::vector<unsigned char> payload;
+
+    if (GetConfigCacheKey(path, key) && ReadSettingsCache(cache_path, key, payload)) {
+        SettingsCacheReader reader(payload);
+        if (ReadCache(reader)) {
+            _MESSAGE("Loaded config from %s.", cache_path.c_str());
+            return true;
+        }
+        _WARNING("Settings cache %s is invalid. Reading the INI.", cache_path.c_str());
+    }
+
+    if (!ParseConfig(path)) {
+        return false;
+    }
+
+    // Saving the INI changes its key, so the key is taken after parsing.
+    SettingsCacheWriter writer;
+    WriteCache(writer);
+    if (!GetConfigCacheKey(path, key) || !WriteSettingsCache(cache_path, key, writer.Data())) {
+        _WARNING("Couldn't write the settings cache %s.", cache_path.c_str());
+    }
+
+    return true;
+}
+
+/**
+ * @brief Parses the INI configuration at the given path.
+ *
+ * If the given file does not exist, the INI will be created with the default
+ * settings at the specified location.
+ *
+ * @param path The path to read the INI file from.
+ */
+bool
+Settings::ParseConfig(
+    const std::string &path
 ) {
     // Attempt to load the INI file.
     _MESSAGE("Loading config file %s...", path.c_str());
     CSimpleIniA ini;
     SI_Error er = ini.LoadFile(path.c_str());
     bool need_save = false;
+    bool exists = true;
     if (er < SI_OK) {
         if ((er != SI_FILE) || (errno != ENOENT)) {
             _ERROR("Can't load config file ret:%d errno:%d", (int)er,  errno);
             return false;
         }
         need_save = true; // No such file or directory.
+        exists = false;
     }
 
     // Load general info.
@@ -326,6 +728,58 @@ Settings::ReadConfig(
         need_save = true;
     }
 
+    ReadSections(ini);
+
+    _MESSAGE("Done!");
+
+    // Save the configuration, if necessary. An outdated config only needs
+    // the settings it is missing.
+    if (need_save) {
+        return (exists && MergeConfig(ini, path)) || SaveConfig(path);
+    } else {
+        return true;
+    }
+}
+
+/**
+ * @brief Parses the INI configuration at the given path for a reload.
+ *
+ * Unlike ReadConfig(), nothing is written: not the INI, not the settings
+ * cache, and not the log. This makes it safe to call from the config watcher
+ * thread. A file which can't be loaded, or which has no version, is rejected.
+ * An editor may have only partly saved the file, so it must not be replaced
+ * with defaults. An outdated file is read as is, and is updated at the next
+ * launch.
+ *
+ * @param path The path to read the INI file from.
+ * @return True if the settings were read.
+ */
+bool
+Settings::ReloadConfig(
+    const std::string &path
+) {
+    CSimpleIniA ini;
+    if (ini.LoadFile(path.c_str()) < SI_OK) {
+        return false;
+    }
+
+    general.ReadConfig(ini);
+    if (!general.version.Get()) {
+        return false;
+    }
+
+    ReadSections(ini);
+    return true;
+}
+
+/**
+ * @brief Reads every section of the INI after the general one, and builds
+ *        the tables derived from them.
+ */
+void
+Settings::ReadSections(
+    CSimpleIniA &ini
+) {
     skillCaps.ReadConfig(ini);
     skillFormulaCaps.ReadConfig(ini);
     enchant.ReadConfig(ini);
@@ -350,14 +804,157 @@ Settings::ReadConfig(
     carryWeightAtStaminaLevelUp.ReadConfig(ini);
     legendary.ReadConfig(ini);
 
-    _MESSAGE("Done!");
+    ApplyExpInterpolation();
+    BuildFormulaClamps();
+    BuildAttributeLevelUps();
+}
 
-    // Save the configuration, if necessary.
-    if (need_save) {
-        return SaveConfig(ini, path);
-    } else {
-        return true;
+/**
+ * @brief Keeps the patch enable flags which the game was patched with.
+ *
+ * The game code is only patched once, at startup, so the hooks must keep
+ * agreeing with the installed settings on which patches exist. This is called
+ * on freshly reloaded settings before they are published.
+ *
+ * @param installed The settings which are currently in use.
+ */
+void
+Settings::KeepInstalledPatches(
+    const Settings &installed
+) {
+    general.KeepInstalledPatches(installed.general);
+    enchant.KeepInstalledPatches(installed.enchant);
+}
+
+/**
+ * @brief Creates the epoch slot of the current thread.
+ *
+ * Slots are never freed, so the list of them can be walked without locking.
+ */
+SettingsEpochSlot *
+RegisterSettingsEpochSlot() {
+    SettingsEpochSlot *slot = new SettingsEpochSlot();
+    slot->epoch.store(0, std::memory_order_relaxed);
+    slot->depth = 0;
+    slot->next = allEpochSlots.load(std::memory_order_relaxed);
+    while (!allEpochSlots.compare_exchange_weak(slot->next, slot));
+    threadEpochSlot = slot;
+    return slot;
+}
+
+/**
+ * @brief Gets the oldest epoch any thread is currently reading in.
+ * @return The oldest epoch, or UINT64_MAX if no thread is reading.
+ */
+static uint64_t
+GetOldestReaderEpoch() {
+    uint64_t oldest = UINT64_MAX;
+    for (SettingsEpochSlot *slot = allEpochSlots.load(); slot; slot = slot->next) {
+        uint64_t epoch = slot->epoch.load();
+        if (epoch && (epoch < oldest)) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief Checks if every skill in SkillCapTable has the same cap.
+ */
+bool
+SkillCapsAreUniform() {
+    for (int i = 1; i < SkillSlot::kCount; i++) {
+        if (SkillCapTable[i] != SkillCapTable[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Makes the given settings the ones in use by this plugin.
+ *
+ * The given settings must be fully read, and must not be modified afterwards.
+ * The previous settings are freed once no guard can still be reading them,
+ * which is checked each time new settings are published.
+ */
+void
+PublishSettings(
+    Settings *next
+) {
+    std::lock_guard<std::mutex> lock(publishLock);
+
+    // Any reader which has seen the old settings entered in an epoch at or
+    // before the one they were retired in.
+    const Settings *prev = activeSettings.exchange(next);
+    uint64_t retired_epoch = settingsEpoch.fetch_add(1);
+
+    // Readers don't fence their epoch store, so it may still be sitting in
+    // the store buffer of their core. Flushing every buffer makes it visible
+    // before the slots are checked. A reader whose store lands after this
+    // point will load the new settings, so it can't hold the old ones.
+    FlushProcessWriteBuffers();
+
+    for (int i = 0; i < SkillSlot::kCount; i++) {
+        auto attr = static_cast<ActorAttribute::t>(ActorAttribute::OneHanded + i);
+        SkillCapTable[i] = next->GetSkillCap(attr);
+    }
+    if (SkillCapDirectSlot) {
+        if (SkillCapsAreUniform()) {
+            *SkillCapDirectSlot = SkillCapTable[0];
+        } else {
+            _WARNING("Skill caps now differ between skills, which requires a restart. "
+                     "Every skill stays capped at %f.", *SkillCapDirectSlot);
+        }
+    }
+    if (prev) {
+        retiredSettings.push_back({ prev, retired_epoch });
+    }
+
+    uint64_t oldest = GetOldestReaderEpoch();
+    size_t kept = 0;
+    for (auto &retired : retiredSettings) {
+        if (retired.second < oldest) {
+            delete retired.first;
+        } else {
+            retiredSettings[kept++] = retired;
+        }
     }
+    retiredSettings.resize(kept);
+}
+
+/**
+ * @brief Fills in the formula clamp range of each attribute from the skill
+ *        formula caps.
+ */
+void
+Settings::BuildFormulaClamps() {
+    const float inf = std::numeric_limits<float>::infinity();
+
+    for (size_t i = 0; i < kFormulaClampCount; i++) {
+        auto attr = static_cast<ActorAttribute::t>(i);
+        if (ActorAttribute::IsSkill(attr)) {
+            formulaClamps[i] = { 0.0f, GetSkillFormulaCap(attr) };
+        } else {
+            formulaClamps[i] = { -inf, inf };
+        }
+    }
+}
+
+/**
+ * @brief Switches the leveled exp multipliers to interpolation, if the INI
+ *        asks for it.
+ *
+ * The slopes and tables are rebuilt here, so lookups stay a single load (or
+ * one multiply-add past the table) either way.
+ */
+void
+Settings::ApplyExpInterpolation() {
+    bool enable = general.interpolateExpMults.Get();
+    skillExpGainMultsWithSkills.SetInterpolated(enable);
+    skillExpGainMultsWithPCLevel.SetInterpolated(enable);
+    levelSkillExpMultsWithSkills.SetInterpolated(enable);
+    levelSkillExpMultsWithPCLevel.SetInterpolated(enable);
 }
 
 /**
@@ -366,7 +963,7 @@ Settings::ReadConfig(
 float
 Settings::GetSkillCap(
     ActorAttribute::t skill
-) {
+) const {
     return skillCaps.Get(SkillSlot::FromAttribute(skill)).Get();
 }
 
@@ -376,7 +973,7 @@ Settings::GetSkillCap(
 float
 Settings::GetSkillFormulaCap(
     ActorAttribute::t skill
-) {
+) const {
     return skillFormulaCaps.Get(SkillSlot::FromAttribute(skill)).Get();
 }
 
@@ -384,7 +981,7 @@ Settings::GetSkillFormulaCap(
  * @brief The maximum level to use for enchantment magnitude.
  */
 float
-Settings::GetEnchantMagnitudeCap() {
+Settings::GetEnchantMagnitudeCap() const {
     return MIN(
         enchant.magnitudeLevelCap.Get(),
         GetSkillFormulaCap(ActorAttribute::Enchanting)
@@ -395,7 +992,7 @@ Settings::GetEnchantMagnitudeCap() {
  * @brief Gets the current enchanting weapon charge cap.
  */
 float
-Settings::GetEnchantChargeCap() {
+Settings::GetEnchantChargeCap() const {
     return MIN(
         MIN(199.0, enchant.chargeLevelCap.Get()),
         GetSkillFormulaCap(ActorAttribute::Enchanting)
@@ -414,7 +1011,7 @@ Settings::GetSkillExpGainMult(
     ActorAttribute::t skill,
     unsigned int skill_level,
     unsigned int player_level
-) {
+) const {
     SkillSlot::t slot = SkillSlot::FromAttribute(skill);
     float base_mult = skillExpGainMults.Get(slot).Get();
     float skill_mult = skillExpGainMultsWithSkills.Get(slot).GetNearest(skill_level);
@@ -434,7 +1031,7 @@ Settings::GetLevelSkillExpMult(
     ActorAttribute::t skill,
     unsigned int skill_level,
     unsigned int player_level
-) {
+) const {
     SkillSlot::t slot = SkillSlot::FromAttribute(skill);
     float base_mult = levelSkillExpMults.Get(slot).Get();
     float skill_mult = levelSkillExpMultsWithSkills.Get(slot).GetNearest(skill_level);
@@ -449,52 +1046,170 @@ Settings::GetLevelSkillExpMult(
 unsigned int
 Settings::GetPerkDelta(
     unsigned int player_level
-) {
+) const {
     return perksAtLevelUp.GetCumulativeDelta(player_level);
 }
 
 /**
- * @brief Calculates the attribute increase from the given player level and
- *        selection.
+ * @brief Calculates the skill exp gain multiplier of every skill at once.
+ *
+ * Each result matches GetSkillExpGainMult() for the same skill.
+ * @param skill_levels The level of each skill, indexed by skill slot.
  * @param player_level The level of the player.
- * @param choice The attribute the player selected to level.
- * @param level_up Returns the deltas for each attribute for this level up.
+ * @param out Returns the multiplier of each skill, indexed by skill slot.
  */
 void
-Settings::GetAttributeLevelUp(
+Settings::GetSkillExpGainMults(
+    const unsigned int skill_levels[SkillSlot::kCount],
     unsigned int player_level,
+    float out[SkillSlot::kCount]
+) const {
+    for (int i = 0; i < SkillSlot::kCount; i++) {
+        SkillSlot::t slot = static_cast<SkillSlot::t>(i);
+        float base_mult = skillExpGainMults.Get(slot).Get();
+        float skill_mult = skillExpGainMultsWithSkills.Get(slot).GetNearest(skill_levels[i]);
+        float pc_mult = skillExpGainMultsWithPCLevel.Get(slot).GetNearest(player_level);
+        out[i] = base_mult * skill_mult * pc_mult;
+    }
+}
+
+/**
+ * @brief Gets the settings which control a level up of the given choice.
+ * @param choice The attribute the player selected to level.
+ * @param out Returns the health, magicka, stamina, and carry weight settings
+ *            of the choice, in that order.
+ * @return The index of the choice in the level up table.
+ */
+size_t
+Settings::GetAttributeChoiceSettings(
     ActorAttribute::t choice,
-    ActorAttributeLevelUp &level_up
-) {
-    unsigned int health = 0, magicka = 0, stamina = 0, carry_weight = 0;
+    const LeveledSetting<unsigned int> *out[4]
+) const {
+    size_t ret = 0;
     switch (choice) {
         case ActorAttribute::Health:
-            health = healthAtLevelUp.GetNearest(player_level);
-            magicka = magickaAtHealthLevelUp.GetNearest(player_level);
-            stamina = staminaAtHealthLevelUp.GetNearest(player_level);
-            carry_weight = carryWeightAtHealthLevelUp.GetNearest(player_level);
+            out[0] = &healthAtLevelUp;
+            out[1] = &magickaAtHealthLevelUp;
+            out[2] = &staminaAtHealthLevelUp;
+            out[3] = &carryWeightAtHealthLevelUp;
+            ret = 0;
             break;
         case ActorAttribute::Magicka:
-            health = healthAtMagickaLevelUp.GetNearest(player_level);
-            magicka = magickaAtLevelUp.GetNearest(player_level);
-            stamina = staminaAtMagickaLevelUp.GetNearest(player_level);
-            carry_weight = carryWeightAtMagickaLevelUp.GetNearest(player_level);
+            out[0] = &healthAtMagickaLevelUp;
+            out[1] = &magickaAtLevelUp;
+            out[2] = &staminaAtMagickaLevelUp;
+            out[3] = &carryWeightAtMagickaLevelUp;
+            ret = 1;
             break;
         case ActorAttribute::Stamina:
-            health = healthAtStaminaLevelUp.GetNearest(player_level);
-            magicka = magickaAtStaminaLevelUp.GetNearest(player_level);
-            stamina = staminaAtLevelUp.GetNearest(player_level);
-            carry_weight = carryWeightAtStaminaLevelUp.GetNearest(player_level);
+            out[0] = &healthAtStaminaLevelUp;
+            out[1] = &magickaAtStaminaLevelUp;
+            out[2] = &staminaAtLevelUp;
+            out[3] = &carryWeightAtStaminaLevelUp;
+            ret = 2;
             break;
         default:
             HALT("Cannot get attribute level up with an invalid choice.");
     }
 
+    return ret;
+}
+
+/**
+ * @brief Fills in the level up table of each choice from the attribute
+ *        settings.
+ */
+void
+Settings::BuildAttributeLevelUps() {
+    const ActorAttribute::t choices[kAttributeChoiceCount] = {
+        ActorAttribute::Health,
+        ActorAttribute::Magicka,
+        ActorAttribute::Stamina
+    };
+
+    unsigned int deltas[4][LEVELED_SETTING_TABLE_SIZE];
+    for (ActorAttribute::t choice : choices) {
+        const LeveledSetting<unsigned int> *attrs[4];
+        size_t c = GetAttributeChoiceSettings(choice, attrs);
+
+        for (size_t a = 0; a < 4; a++) {
+            attrs[a]->GetNearestRange(0, LEVELED_SETTING_TABLE_SIZE, deltas[a]);
+        }
+
+        for (size_t level = 0; level < LEVELED_SETTING_TABLE_SIZE; level++) {
+            attributeLevelUps[c][level] = {
+                static_cast<float>(deltas[0][level]),
+                static_cast<float>(deltas[1][level]),
+                static_cast<float>(deltas[2][level]),
+                static_cast<float>(deltas[3][level])
+            };
+        }
+    }
+}
+
+/**
+ * @brief Calculates the attribute increase from the given player level and
+ *        selection.
+ * @param player_level The level of the player.
+ * @param choice The attribute the player selected to level.
+ * @param level_up Returns the deltas for each attribute for this level up.
+ */
+void
+Settings::GetAttributeLevelUp(
+    unsigned int player_level,
+    ActorAttribute::t choice,
+    ActorAttributeLevelUp &level_up
+) const {
+    static_assert((ActorAttribute::Magicka == ActorAttribute::Health + 1)
+               && (ActorAttribute::Stamina == ActorAttribute::Health + 2),
+                  "The level up choices must be contiguous.");
+
+    // The table is indexed directly by the choice, so that a level up within
+    // it never has to look the settings of the choice up. An invalid choice
+    // falls through to the lookup below, which halts on it.
+    size_t c = static_cast<size_t>(choice) - ActorAttribute::Health;
+    if ((c < kAttributeChoiceCount) && (player_level < LEVELED_SETTING_TABLE_SIZE)) {
+        level_up = attributeLevelUps[c][player_level];
+        return;
+    }
+
+    const LeveledSetting<unsigned int> *attrs[4];
+    GetAttributeChoiceSettings(choice, attrs);
     level_up = {
-        static_cast<float>(health),
-        static_cast<float>(magicka),
-        static_cast<float>(stamina),
-        static_cast<float>(carry_weight)
+        static_cast<float>(attrs[0]->GetNearest(player_level)),
+        static_cast<float>(attrs[1]->GetNearest(player_level)),
+        static_cast<float>(attrs[2]->GetNearest(player_level)),
+        static_cast<float>(attrs[3]->GetNearest(player_level))
+    };
+}
+
+/**
+ * @brief Calculates the total attribute increase from making the same
+ *        selection at each level in a range.
+ *
+ * Gives the same result as adding up GetAttributeLevelUp() for each level,
+ * but takes the same time no matter how many levels are given.
+ *
+ * @param first_level The first player level to evaluate.
+ * @param count The number of levels to evaluate.
+ * @param choice The attribute the player selected to level.
+ * @param level_up Returns the summed deltas for each attribute.
+ */
+void
+Settings::GetAttributeLevelUpRange(
+    unsigned int first_level,
+    size_t count,
+    ActorAttribute::t choice,
+    ActorAttributeLevelUp &level_up
+) const {
+    const LeveledSetting<unsigned int> *attrs[4];
+    GetAttributeChoiceSettings(choice, attrs);
+
+    level_up = {
+        static_cast<float>(attrs[0]->GetSumRange(first_level, count)),
+        static_cast<float>(attrs[1]->GetSumRange(first_level, count)),
+        static_cast<float>(attrs[2]->GetSumRange(first_level, count)),
+        static_cast<float>(attrs[3]->GetSumRange(first_level, count))
     };
 }
 
@@ -506,7 +1221,7 @@ Settings::GetAttributeLevelUp(
 bool
 Settings::IsLegendaryButtonVisible(
     unsigned int skill_level
-) {
+) const {
     return (skill_level >= legendary.skillLevelEnable.Get())
         && (!legendary.hideButton.Get());
 }
@@ -517,7 +1232,7 @@ Settings::IsLegendaryButtonVisible(
 bool
 Settings::IsLegendaryAvailable(
     unsigned int skill_level
-) {
+) const {
     return skill_level >= legendary.skillLevelEnable.Get();
 }
 
@@ -528,7 +1243,7 @@ float
 Settings::GetPostLegendarySkillLevel(
     float default_reset,
     float base_level
-) {
+) const {
     // Check if legendarying should reset the level at all.
     if (legendary.keepSkillLevel.Get()) {
         return base_level;
@@ -12,15 +12,33 @@
 #ifndef __SKYRIM_UNCAPPER_AE_SETTINGS_H__
 #define __SKYRIM_UNCAPPER_AE_SETTINGS_H__
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "Compare.h"
 #include "SkillSlot.h"
 #include "Ini.h"
+#include "SettingsCache.h"
 #include "ActorAttribute.h"
 
-#define CONFIG_VERSION 6
+#define CONFIG_VERSION 8
+
+/**
+ * @brief The number of levels, starting from 0, for which each leveled setting
+ *        keeps a precomputed value.
+ *
+ * Lookups for levels below this bound are a single array load. Lookups at or
+ * above it fall back to a binary search. May be overridden by the build.
+ */
+#ifndef LEVELED_SETTING_TABLE_SIZE
+#define LEVELED_SETTING_TABLE_SIZE 256
+#endif
 
 template<typename T>
 class LeveledSetting {
@@ -33,44 +51,51 @@ class LeveledSetting {
     /// @brief The buffer size used to concat the section and subsection.
     static const size_t kBufSize = 256;
 
-    std::vector<LevelItem> list;
+    /**
+     * @brief The level of each item, in ascending order.
+     *
+     * The levels and items are kept in separate arrays, so that searching for
+     * a level only touches the cache lines holding levels.
+     */
+    std::vector<unsigned int> levels;
+    std::vector<T> items;
+
+    /// @brief The slope from each item to the next. All zero unless the
+    ///        setting is interpolated.
+    std::vector<T> slopes;
+    std::vector<T> table;
+    std::vector<T> prefix;
     const char *section;
     T defaultVal;
+    bool interpolate;
 
     /**
-     * @brief Adds an item to the leveled setting list.
+     * @brief Replaces the contents of the list with the given items.
      *
-     * If the given item is already in the setting list, it will not be added
-     * again.
+     * The items are sorted by level. If the same level is given more than
+     * once, only the first item given for it is kept.
      *
-     * @param level The level for the item.
-     * @param item The item to be added.
+     * @param pending The items to build the list from. Reordered by this call.
      */
     void
-    Add(
-        unsigned int level,
-        T item
+    Build(
+        std::vector<LevelItem> &pending
     ) {
-        // Store the items in sorted order, so we can binary search for the
-        // nearest later.
-        size_t lo = 0, hi = list.size();
-        size_t mid = lo + ((hi - lo) >> 1);
-        while (lo < hi) {
-            ASSERT(mid < list.size());
-            if (level < list[mid].level) {
-                hi = mid;
-            } else if (level > list[mid].level) {
-                lo = mid + 1;
-            } else {
-                return;
+        std::stable_sort(pending.begin(), pending.end(),
+            [](const LevelItem &a, const LevelItem &b) { return a.level < b.level; });
+
+        levels.clear();
+        items.clear();
+        levels.reserve(pending.size());
+        items.reserve(pending.size());
+        for (const LevelItem &item : pending) {
+            if (levels.empty() || (levels.back() != item.level)) {
+                levels.push_back(item.level);
+                items.push_back(item.item);
             }
-
-            mid = lo + ((hi - lo) >> 1);
         }
 
-        // Insert before the final hi element.
-        ASSERT(hi <= list.size());
-        list.insert(list.begin() + hi, { level, item });
+        Finalize();
     }
 
     /**
@@ -86,52 +111,210 @@ class LeveledSetting {
         T val
     ) {
         CSimpleIniA::TNamesDepend keys;
+        ini.GetAllKeys(sec, keys);
+
+        std::vector<LevelItem> pending;
+        pending.reserve(keys.size() + 1);
+        for (auto& element : keys) {
+            pending.push_back({
+                static_cast<unsigned int>(atoi(element.pItem)),
+                ReadIniValue(ini, sec, element.pItem, val)
+            });
+        }
+
+        // Added last, so that a level 0 given by the INI takes precedence.
+        pending.push_back({ 0, val });
+        Build(pending);
+    }
+
+    /**
+     * @brief Finds the index of the item closest to the given level.
+     *
+     * Note that only items whose level is less than or equal to the given
+     * level will be considered.
+     *
+     * @param level The level to search for an item for.
+     * @return The index of the item in the list.
+     */
+    size_t
+    FindIndex(
+        unsigned int level
+    ) const {
+        ASSERT(levels.size() > 0);
+        ASSERT(levels[0] == 0);
+
+        // The first level is always 0, so the item before the first greater
+        // level always exists.
+        return (std::upper_bound(levels.begin(), levels.end(), level) - levels.begin()) - 1;
+    }
+
+    /**
+     * @brief Rebuilds everything derived from the list.
+     *
+     * Must be called whenever the list is changed.
+     */
+    void
+    Finalize(
+        void
+    ) {
+        ASSERT(levels.size() == items.size());
+        BuildSlopes();
+        BuildTable();
+        BuildPrefixSums();
+    }
+
+    /**
+     * @brief Computes the slope of each segment between two items.
+     *
+     * The value of the last item holds for every level after it, so its slope
+     * is always zero.
+     *
+     * Must be called whenever the list is changed.
+     */
+    void
+    BuildSlopes(
+        void
+    ) {
+        slopes.assign(levels.size(), 0);
+        if (!interpolate) {
+            return;
+        }
 
-        list.clear();
-        if (ini.GetAllKeys(sec, keys)) {
-            for (auto& element : keys) {\
-                Add(
-                    atoi(element.pItem),
-                    ReadIniValue(ini, sec, element.pItem, val)
-                );
+        for (size_t i = 0; (i + 1) < levels.size(); i++) {
+            slopes[i] = (items[i + 1] - items[i]) / (levels[i + 1] - levels[i]);
+        }
+    }
+
+    /**
+     * @brief Gets the value of the given level within the given item.
+     *
+     * When the setting is not interpolated, the slope is zero and this is
+     * exactly the value of the item.
+     */
+    inline T
+    GetValueAt(
+        size_t i,
+        unsigned int level
+    ) const {
+        return items[i] + slopes[i] * static_cast<T>(level - levels[i]);
+    }
+
+    /**
+     * @brief Fills in the precomputed values for the levels below
+     *        LEVELED_SETTING_TABLE_SIZE.
+     *
+     * Must be called whenever the list is changed.
+     */
+    void
+    BuildTable(
+        void
+    ) {
+        ASSERT(levels.size() > 0);
+        ASSERT(levels[0] == 0);
+
+        table.resize(LEVELED_SETTING_TABLE_SIZE);
+        for (size_t i = 0; i < levels.size(); i++) {
+            size_t end = ((i + 1) < levels.size()) ? levels[i + 1] : table.size();
+            for (size_t level = levels[i]; level < MIN(end, table.size()); level++) {
+                table[level] = GetValueAt(i, static_cast<unsigned int>(level));
             }
         }
+    }
 
-        Add(0, val);
-        list.shrink_to_fit();
+    /**
+     * @brief Accumulates the value of every level before the start of each
+     *        item in the list.
+     *
+     * Must be called whenever the list is changed.
+     */
+    void
+    BuildPrefixSums(
+        void
+    ) {
+        ASSERT(levels.size() > 0);
+
+        T acc = 0;
+        prefix.resize(levels.size());
+        for (size_t i = 0; i < levels.size(); i++) {
+            prefix[i] = acc;
+            if ((i + 1) < levels.size()) {
+                acc += (levels[i + 1] - levels[i]) * items[i];
+            }
+        }
     }
 
     /**
      * @brief Saves the content of the list to the given INI file.
+     *
+     * When merging, a section the file already has is left alone. Its levels
+     * are whatever the user defined, so adding our defaults would change them.
+     *
      * @param ini The INI file to write to.
      * @param sec The section to write to.
      * @param comment The comment to write to the first element.
      */
     void
     InternalSaveConfig(
-        CSimpleIniA &ini,
+        IniWriter &ini,
         const char *sec,
         const char *comment
     ) {
+        if (ini.HasSection(sec)) { return; }
+
         char key[16];
-        for (size_t i = 0; i < list.size(); i++) {
-            ASSERT(sprintf_s(key, "%d", list[i].level) > 0);\
+        for (size_t i = 0; i < levels.size(); i++) {
+            auto res = std::to_chars(key, key + sizeof(key) - 1, levels[i]);
+            ASSERT(res.ec == std::errc());
+            *res.ptr = '\0';
             SaveIniValue(
                 ini,
                 sec,
                 key,
-                list[i].item,
+                items[i],
                 (!i) ? (comment) : NULL
             );
         }
     }
 
+    /**
+     * @brief Gets the cumulative delta of the given level within the given
+     *        item.
+     */
+    inline unsigned int
+    GetCumulativeDeltaAt(
+        size_t i,
+        unsigned int level
+    ) const {
+        // Everything before the item containing this level has already been
+        // accumulated. Note the inclusive upper bound on level.
+        T acc = prefix[i] + (level + 1 - levels[i]) * items[i];
+        T pacc = acc - items[i];
+
+        return static_cast<unsigned int>(acc) - static_cast<unsigned int>(pacc);
+    }
+
+    /**
+     * @brief Sums the values of every level below the given level.
+     */
+    inline T
+    GetSumBelow(
+        unsigned int level
+    ) const {
+        size_t i = FindIndex(level);
+        return prefix[i] + (level - levels[i]) * items[i];
+    }
+
   public:
     /// @brief Default constructor. Must give args to ReadConfig()/SaveConfig().
     LeveledSetting(
-    ) : list(0),
+    ) : levels(0),
+        items(0),
+        slopes(0),
+        table(0),
+        prefix(0),
         section(nullptr),
-        defaultVal(0)
+        defaultVal(0),
+        interpolate(false)
     {}
 
     /**
@@ -146,9 +329,14 @@ class LeveledSetting {
     LeveledSetting(
         const char *section,
         T default_val
-    ) : list(0),
+    ) : levels(0),
+        items(0),
+        slopes(0),
+        table(0),
+        prefix(0),
         section(section),
-        defaultVal(default_val)
+        defaultVal(default_val),
+        interpolate(false)
     {}
 
     /**
@@ -206,7 +394,7 @@ class LeveledSetting {
      */
     void
     SaveConfig(
-        CSimpleIniA &ini,
+        IniWriter &ini,
         const char *sec,
         const char *subsec,
         const char *comment
@@ -230,18 +418,100 @@ class LeveledSetting {
      */
     void
     SaveConfig(
-        CSimpleIniA &ini,
+        IniWriter &ini,
         const char *comment
     ) {
         ASSERT(section);
         InternalSaveConfig(ini, section, comment);
     }
 
+    /**
+     * @brief Writes the list to the given settings cache.
+     *
+     * The table and prefix sums are not written, as they are cheap to rebuild.
+     */
+    void
+    WriteCache(
+        SettingsCacheWriter &cache
+    ) const {
+        static_assert(std::is_trivially_copyable<T>::value, "Items must be flat");
+        cache.Write(static_cast<uint64_t>(levels.size()));
+        cache.Write(levels.data(), levels.size() * sizeof(unsigned int));
+        cache.Write(items.data(), items.size() * sizeof(T));
+    }
+
+    /**
+     * @brief Reads the list from the given settings cache.
+     *
+     * The levels and items are each copied into place in one go, rather than
+     * being inserted one at a time.
+     *
+     * @return True if the list was read, false otherwise.
+     */
+    bool
+    ReadCache(
+        SettingsCacheReader &cache
+    ) {
+        uint64_t count;
+        if (!cache.Read(count) || !count || (count > SIZE_MAX / sizeof(T))
+                || (count > SIZE_MAX / sizeof(unsigned int))) {
+            return false;
+        }
+
+        const size_t n = static_cast<size_t>(count);
+        const void *level_data = cache.Take(n * sizeof(unsigned int));
+        const void *item_data = cache.Take(n * sizeof(T));
+        if (!level_data || !item_data) {
+            return false;
+        }
+
+        levels.resize(n);
+        items.resize(n);
+        memcpy(levels.data(), level_data, n * sizeof(unsigned int));
+        memcpy(items.data(), item_data, n * sizeof(T));
+
+        // The lookups depend on the list being sorted and starting at 0.
+        if (levels[0] != 0) {
+            return false;
+        }
+        for (size_t i = 1; i < n; i++) {
+            if (levels[i - 1] >= levels[i]) {
+                return false;
+            }
+        }
+
+        Finalize();
+        return true;
+    }
+
+    /**
+     * @brief Sets whether values between two items are interpolated.
+     *
+     * When interpolated, the items are treated as the control points of a
+     * piecewise linear curve, rather than as steps. Levels past the last item
+     * still take its value. Only settings which are never accumulated may be
+     * interpolated.
+     *
+     * @param enable True to interpolate, false to use steps.
+     */
+    void
+    SetInterpolated(
+        bool enable
+    ) {
+        static_assert(std::is_floating_point<T>::value,
+                      "Only floating point settings can be interpolated");
+        if (interpolate != enable) {
+            interpolate = enable;
+            Finalize();
+        }
+    }
+
     /**
      * @brief Finds the value closest to the given level in the list.
      *
      * Note that only values whose level is less than or equal to the given
-     * level will be considered.
+     * level will be considered. If the setting is interpolated, the value is
+     * instead interpolated from the items around the level.
      *
      * @param level The level to search for an item for.
      * @return The associated value.
@@ -249,28 +519,12 @@ class LeveledSetting {
     T
     GetNearest(
         unsigned int level
-    ) {
-        ASSERT(list.size() > 0);
-
-        size_t lo = 0, hi = list.size();
-        size_t mid = lo + ((hi - lo) >> 1);
-        while (lo < hi) {
-            ASSERT(mid < list.size());
-            if ((list[mid].level <= level)
-                    && ((mid + 1 == list.size()) || (level < list[mid + 1].level))) {
-                return list[mid].item;
-            } else if (level < list[mid].level) {
-                hi = mid;
-            } else {
-                ASSERT((level > list[mid].level) || (level >= list[mid + 1].level));
-                lo = mid + 1;
-            }
-
-            mid = lo + ((hi - lo) >> 1);
+    ) const {
+        if (level < table.size()) {
+            return table[level];
         }
 
-        // If no direct match was found, return the closest lo item.
-        return list[lo].item;
+        return GetValueAt(FindIndex(level), level);
     }
 
     /**
@@ -286,23 +540,72 @@ class LeveledSetting {
     unsigned int
     GetCumulativeDelta(
         unsigned int level
-    ) {
-        ASSERT(list.size() > 0);
-
-        T pacc = 0, acc = 0;
-        for (size_t i = 0; (i < list.size()) && (list[i].level <= level); i++) {
-            // Update the accumulation. Note the exclusive upper bound on level.
-            unsigned int bound = ((i + 1) < list.size()) ? list[i + 1].level : level + 1;
-            unsigned int this_level = MIN(level + 1, bound);
-            acc += (this_level - list[i].level) * list[i].item;
-
-            // If this is the last iteration, get the previous accumulation.
-            if (((i + 1) >= list.size()) || (list[i + 1].level > level)) {
-                pacc = acc - list[i].item;
+    ) const {
+        ASSERT(!interpolate);
+        return GetCumulativeDeltaAt(FindIndex(level), level);
+    }
+
+    /**
+     * @brief Finds the value closest to each level in a range.
+     *
+     * Gives the same results as calling GetNearest() on each level, but copies
+     * straight from the table and walks the list only once beyond it.
+     *
+     * @param first The first level to evaluate.
+     * @param count The number of levels to evaluate.
+     * @param out Returns the value for each level. Must hold count values.
+     */
+    void
+    GetNearestRange(
+        unsigned int first,
+        size_t count,
+        T *out
+    ) const {
+        size_t n = 0;
+
+        if (first < table.size()) {
+            n = MIN(count, table.size() - first);
+            std::copy(table.begin() + first, table.begin() + first + n, out);
+        }
+
+        if (n < count) {
+            size_t i = FindIndex(static_cast<unsigned int>(first + n));
+            while (n < count) {
+                size_t end = count;
+                if ((i + 1) < levels.size()) {
+                    end = MIN(count, static_cast<size_t>(levels[i + 1] - first));
+                }
+
+                if (slopes[i] == 0) {
+                    std::fill(out + n, out + end, items[i]);
+                } else {
+                    for (; n < end; n++) {
+                        out[n] = GetValueAt(i, static_cast<unsigned int>(first + n));
+                    }
+                }
+                n = end;
+                i++;
             }
         }
+    }
 
-        return static_cast<unsigned int>(acc) - static_cast<unsigned int>(pacc);
+    /**
+     * @brief Sums the values of every level in a range.
+     *
+     * Gives the same result as adding up GetNearest() for each level, but
+     * only ever searches the list twice. The end of the range must fit in an
+     * unsigned int, which the caller is responsible for checking.
+     *
+     * @param first The first level to sum.
+     * @param count The number of levels to sum.
+     */
+    T
+    GetSumRange(
+        unsigned int first,
+        size_t count
+    ) const {
+        ASSERT(!interpolate);
+        return GetSumBelow(static_cast<unsigned int>(first + count)) - GetSumBelow(first);
     }
 };
 
@@ -321,7 +624,7 @@ class SkillSetting {
      * @brief Gets the value contained by this skill setting.
      */
     inline T
-    Get() {
+    Get() const {
         return val;
     }
 
@@ -354,16 +657,39 @@ class SkillSetting {
      */
     void
     SaveConfig(
-        CSimpleIniA &ini,
+        IniWriter &ini,
         const char *section,
         const char *field,
         const char *comment
     ) {
         char buf[kBufSize];
-        auto res = sprintf_s(buf, "%c%s", GetPrefix<T>(), field);
-        ASSERT((0 < res) && (res < kBufSize));
+        size_t len = strlen(field);
+        ASSERT(len + 1 < kBufSize);
+        buf[0] = GetPrefix<T>();
+        memcpy(buf + 1, field, len + 1);
         SaveIniValue(ini, section, buf, val, comment);
     }
+
+    /**
+     * @brief Writes the value to the given settings cache.
+     */
+    void
+    WriteCache(
+        SettingsCacheWriter &cache
+    ) const {
+        cache.Write(val);
+    }
+
+    /**
+     * @brief Reads the value from the given settings cache.
+     * @return True if the value was read, false otherwise.
+     */
+    bool
+    ReadCache(
+        SettingsCacheReader &cache
+    ) {
+        return cache.Read(val);
+    }
 };
 
 template <template<typename> class T, typename U>
@@ -385,10 +711,10 @@ class SkillSettingManager {
      * @brief Gets the setting for the given skill.
      * @param The skill to get the setting for.
      */
-    T<U>&
+    const T<U>&
     Get(
         SkillSlot::t skill
-    ) {
+    ) const {
         return data[skill];
     }
 
@@ -413,7 +739,7 @@ class SkillSettingManager {
      */
     void
     SaveConfig(
-        CSimpleIniA &ini,
+        IniWriter &ini,
         const char *comment
     ) {
         for (int i = 0; i < SkillSlot::kCount; i++) {
@@ -421,9 +747,57 @@ class SkillSettingManager {
             data[i].SaveConfig(ini, section, SkillSlot::Str(slot), (!i) ? comment : NULL);
         }
     }
+
+    /**
+     * @brief Sets whether the setting of each skill is interpolated.
+     *
+     * May only be used with leveled settings.
+     */
+    void
+    SetInterpolated(
+        bool enable
+    ) {
+        for (int i = 0; i < SkillSlot::kCount; i++) {
+            data[i].SetInterpolated(enable);
+        }
+    }
+
+    /**
+     * @brief Writes the setting of each skill to the given settings cache.
+     */
+    void
+    WriteCache(
+        SettingsCacheWriter &cache
+    ) const {
+        for (int i = 0; i < SkillSlot::kCount; i++) {
+            data[i].WriteCache(cache);
+        }
+    }
+
+    /**
+     * @brief Reads the setting of each skill from the given settings cache.
+     * @return True if every setting was read, false otherwise.
+     */
+    bool
+    ReadCache(
+        SettingsCacheReader &cache
+    ) {
+        for (int i = 0; i < SkillSlot::kCount; i++) {
+            if (!data[i].ReadCache(cache)) {
+                return false;
+            }
+        }
+        return true;
+    }
 };
 
-class Settings {
+/**
+ * @brief Holds every setting read from the INI file.
+ *
+ * Each instance is aligned to a cache line, so that the settings read by the
+ * hooks never share a line with data written by another thread.
+ */
+class alignas(64) Settings {
   private:
     class GeneralSettings {
       private:
@@ -437,6 +811,8 @@ class Settings {
         static const char *const kEnablePerkPointsDesc;
         static const char *const kEnableAttributePointsDesc;
         static const char *const kEnableLegendaryDesc;
+        static const char *const kEnableConfigHotReloadDesc;
+        static const char *const kInterpolateExpMultsDesc;
 
       public:
         SectionField<unsigned int> version;
@@ -449,6 +825,8 @@ class Settings {
         SectionField<bool> enablePerkPoints;
         SectionField<bool> enableAttributePoints;
         SectionField<bool> enableLegendary;
+        SectionField<bool> enableConfigHotReload;
+        SectionField<bool> interpolateExpMults;
 
         GeneralSettings(
         ) : version("Version", 0),
@@ -460,11 +838,17 @@ class Settings {
             enableLevelExpMults("bUsePCLevelSkillExpMults", true),
             enablePerkPoints("bUsePerksAtLevelUp", true),
             enableAttributePoints("bUseAttributesAtLevelUp", true),
-            enableLegendary("bUseLegendarySettings", true)
+            enableLegendary("bUseLegendarySettings", true),
+            enableConfigHotReload("bEnableConfigHotReload", false),
+            interpolateExpMults("bInterpolateExpMults", false)
         {}
 
         void ReadConfig(CSimpleIniA &ini);
-        void SaveConfig(CSimpleIniA &ini);
+        void SaveConfig(IniWriter &ini);
+        bool MergeVersion(IniWriter &ini);
+        void WriteCache(SettingsCacheWriter &cache) const;
+        bool ReadCache(SettingsCacheReader &cache);
+        void KeepInstalledPatches(const GeneralSettings &installed);
     };
 
     class EnchantSettings {
@@ -486,7 +870,10 @@ class Settings {
         {}
 
         void ReadConfig(CSimpleIniA &ini);
-        void SaveConfig(CSimpleIniA &ini);
+        void SaveConfig(IniWriter &ini);
+        void WriteCache(SettingsCacheWriter &cache) const;
+        bool ReadCache(SettingsCacheReader &cache);
+        void KeepInstalledPatches(const EnchantSettings &installed);
     };
 
     class LegendarySettings {
@@ -511,7 +898,9 @@ class Settings {
         {}
 
         void ReadConfig(CSimpleIniA &ini);
-        void SaveConfig(CSimpleIniA &ini);
+        void SaveConfig(IniWriter &ini);
+        void WriteCache(SettingsCacheWriter &cache) const;
+        bool ReadCache(SettingsCacheReader &cache);
     };
 
     static const char *const kSkillCapsDesc;
@@ -536,7 +925,13 @@ class Settings {
     static const char *const kCarryWeightAtMagickaLevelUpDesc;
     static const char *const kCarryWeightAtStaminaLevelUpDesc;
 
-    bool SaveConfig(CSimpleIniA &ini, const std::string &path);
+    bool ParseConfig(const std::string &path);
+    void ReadSections(CSimpleIniA &ini);
+    void WriteConfig(IniWriter &ini);
+    bool SaveConfig(const std::string &path);
+    bool MergeConfig(const CSimpleIniA &ini, const std::string &path);
+    void WriteCache(SettingsCacheWriter &cache) const;
+    bool ReadCache(SettingsCacheReader &cache);
 
     GeneralSettings general;
 
@@ -569,6 +964,45 @@ class Settings {
 
     LegendarySettings legendary;
 
+    /// @brief The number of raw attribute IDs covered by the formula clamp table.
+    static const size_t kFormulaClampCount = ActorAttribute::CarryWeight + 1;
+
+    /// @brief The range an attribute is clamped to by the formula cap.
+    struct FormulaClamp {
+        float lo;
+        float hi;
+    };
+
+    /**
+     * @brief The formula clamp range of each attribute, indexed by its raw ID.
+     *
+     * Attributes which are not skills are given an unbounded range. The table
+     * is small and aligned, so it stays resident while the game reads actor
+     * values in a loop.
+     */
+    alignas(64) FormulaClamp formulaClamps[kFormulaClampCount];
+
+    /// @brief The number of attributes which can be chosen at a level up.
+    static const size_t kAttributeChoiceCount = 3;
+
+    /**
+     * @brief The deltas of each level up choice, indexed by the choice and
+     *        then the level, for every level in the leveled setting tables.
+     *
+     * Each level up is a single aligned load from here, rather than a lookup
+     * in each of the four settings for the choice.
+     */
+    alignas(64) ActorAttributeLevelUp attributeLevelUps[kAttributeChoiceCount]
+                                                     [LEVELED_SETTING_TABLE_SIZE];
+
+    void BuildFormulaClamps(void);
+    void BuildAttributeLevelUps(void);
+    size_t GetAttributeChoiceSettings(
+        ActorAttribute::t choice,
+        const LeveledSetting<unsigned int> *out[4]
+    ) const;
+    void ApplyExpInterpolation(void);
+
   public:
     Settings(
     ) : general(),
@@ -598,33 +1032,171 @@ class Settings {
     {}
 
     bool ReadConfig(const std::string& path);
+    bool ReloadConfig(const std::string &path);
+    void KeepInstalledPatches(const Settings &installed);
+
+    inline bool IsSkillCapEnabled(void) const { return general.enableSkillCaps.Get(); }
+    inline bool IsSkillFormulaCapEnabled(void) const { return general.enableSkillFormulaCaps.Get(); }
+    inline bool IsEnchantPatchEnabled(void) const { return general.enableEnchantingPatch.Get(); }
+    inline bool IsSkillExpEnabled(void) const { return general.enableSkillExpMults.Get(); }
+    inline bool IsLevelExpEnabled(void) const { return general.enableLevelExpMults.Get(); }
+    inline bool IsPerkPointsEnabled(void) const { return general.enablePerkPoints.Get(); }
+    inline bool IsAttributePointsEnabled(void) const { return general.enableAttributePoints.Get(); }
+    inline bool IsLegendaryEnabled(void) const { return general.enableLegendary.Get(); }
+    inline bool IsConfigHotReloadEnabled(void) const { return general.enableConfigHotReload.Get(); }
+
+    float GetSkillCap(ActorAttribute::t skill) const;
+    float GetSkillFormulaCap(ActorAttribute::t skill) const;
 
-    inline bool IsSkillCapEnabled(void) { return general.enableSkillCaps.Get(); }
-    inline bool IsSkillFormulaCapEnabled(void) { return general.enableSkillFormulaCaps.Get(); }
-    inline bool IsEnchantPatchEnabled(void) { return general.enableEnchantingPatch.Get(); }
-    inline bool IsSkillExpEnabled(void) { return general.enableSkillExpMults.Get(); }
-    inline bool IsLevelExpEnabled(void) { return general.enableLevelExpMults.Get(); }
-    inline bool IsPerkPointsEnabled(void) { return general.enablePerkPoints.Get(); }
-    inline bool IsAttributePointsEnabled(void) { return general.enableAttributePoints.Get(); }
-    inline bool IsLegendaryEnabled(void) { return general.enableLegendary.Get(); }
-
-    float GetSkillCap(ActorAttribute::t skill);
-    float GetSkillFormulaCap(ActorAttribute::t skill);
-    float GetEnchantMagnitudeCap(void);
-    float GetEnchantChargeCap(void);
-    inline bool IsEnchantChargeLinear(void) { return enchant.useLinearChargeFormula.Get(); }
+    /**
+     * @brief Clamps the given attribute value to its skill formula cap.
+     *
+     * Attributes which are not skills are returned unchanged.
+     */
+    inline float
+    ClampSkillFormula(
+        ActorAttribute::t attr,
+        float val
+    ) const {
+        if (static_cast<unsigned int>(attr) < kFormulaClampCount) {
+            const FormulaClamp &clamp = formulaClamps[attr];
+            val = MAX(clamp.lo, MIN(clamp.hi, val));
+        }
+        return val;
+    }
+
+    float GetEnchantMagnitudeCap(void) const;
+    float GetEnchantChargeCap(void) const;
+    inline bool IsEnchantChargeLinear(void) const { return enchant.useLinearChargeFormula.Get(); }
     float GetSkillExpGainMult(ActorAttribute::t skill, unsigned int skill_level,
-                              unsigned int player_level);
+                              unsigned int player_level) const;
     float GetLevelSkillExpMult(ActorAttribute::t skill, unsigned int skill_level,
-                               unsigned int player_level);
-    unsigned int GetPerkDelta(unsigned int player_level);
+                               unsigned int player_level) const;
+    unsigned int GetPerkDelta(unsigned int player_level) const;
+
+    void GetSkillExpGainMults(const unsigned int skill_levels[SkillSlot::kCount],
+                              unsigned int player_level,
+                              float out[SkillSlot::kCount]) const;
     void GetAttributeLevelUp(unsigned int player_level, ActorAttribute::t attr,
-                             ActorAttributeLevelUp &level_up);
-    bool IsLegendaryButtonVisible(unsigned int skill_level);
-    bool IsLegendaryAvailable(unsigned int skill_level);
-    float GetPostLegendarySkillLevel(float default_reset, float base_level);
+                             ActorAttributeLevelUp &level_up) const;
+    void GetAttributeLevelUpRange(unsigned int first_level, size_t count,
+                                  ActorAttribute::t choice,
+                                  ActorAttributeLevelUp &level_up) const;
+    bool IsLegendaryButtonVisible(unsigned int skill_level) const;
+    bool IsLegendaryAvailable(unsigned int skill_level) const;
+    float GetPostLegendarySkillLevel(float default_reset, float base_level) const;
+};
+
+/**
+ * @brief The settings currently in use by this plugin.
+ *
+ * A settings object is never modified once it has been published here. When
+ * the INI is reloaded, a new object is read and swapped in as a whole, so the
+ * hooks never see a partially updated config. Use a SettingsGuard to read it.
+ */
+extern std::atomic<const Settings*> activeSettings;
+
+/**
+ * @brief The current reclamation epoch. Advanced each time settings are
+ *        published.
+ */
+extern std::atomic<uint64_t> settingsEpoch;
+
+/**
+ * @brief The epoch a thread entered its outermost SettingsGuard in.
+ *
+ * Each thread which reads the settings owns one of these, so readers never
+ * write to a cache line shared with another thread.
+ */
+struct alignas(64) SettingsEpochSlot {
+    /// @brief The epoch the thread is reading in, or 0 if it is not reading.
+    std::atomic<uint64_t> epoch;
+
+    /// @brief The number of guards the thread holds. Only touched by its owner.
+    unsigned int depth;
+
+    SettingsEpochSlot *next;
 };
 
-extern Settings settings;
+/// @brief The epoch slot of the current thread, if it has one.
+extern thread_local SettingsEpochSlot *threadEpochSlot;
+
+SettingsEpochSlot *RegisterSettingsEpochSlot(void);
+
+/**
+ * @brief Holds a consistent view of the settings for the life of the guard.
+ *
+ * The settings seen by a guard will not be freed until every guard which
+ * could have seen them has been destroyed. Guards may be nested. Taking a
+ * guard never locks, and only writes to the current threads epoch slot.
+ */
+class SettingsGuard {
+  private:
+    SettingsEpochSlot *slot;
+    const Settings *snapshot;
+
+  public:
+    SettingsGuard() {
+        slot = threadEpochSlot;
+        if (!slot) {
+            slot = RegisterSettingsEpochSlot();
+        }
+
+        // The epoch must be visible to the writer before we read the pointer.
+        // A full barrier here would cost every hook call, so the writer
+        // flushes the store buffer of every core instead, before it checks
+        // the slots (see PublishSettings()). The signal fence only keeps the
+        // compiler from moving the pointer load above the epoch store.
+        if (slot->depth++ == 0) {
+            slot->epoch.store(
+                settingsEpoch.load(std::memory_order_acquire),
+                std::memory_order_relaxed
+            );
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+        snapshot = activeSettings.load(std::memory_order_acquire);
+    }
+
+    ~SettingsGuard() {
+        if (--slot->depth == 0) {
+            slot->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    SettingsGuard(const SettingsGuard&) = delete;
+    SettingsGuard &operator=(const SettingsGuard&) = delete;
+
+    /**
+     * @brief Gets the settings held by this guard.
+     */
+    inline const Settings &
+    Get() const {
+        return *snapshot;
+    }
+};
+
+/**
+ * @brief The skill cap of each skill in the active settings, indexed by skill
+ *        slot.
+ *
+ * Kept up to date by PublishSettings(), so that SkillCapPatch_Wrapper can look
+ * a cap up with a single load instead of calling into C++. Each entry is
+ * updated with one aligned store, so a reader sees either the old cap of a
+ * skill or the new one.
+ */
+extern "C" float SkillCapTable[SkillSlot::kCount];
+
+/**
+ * @brief The cap the game loads directly when every skill had the same cap at
+ *        patch time, or null if SkillCapPatch calls its hook instead.
+ *
+ * Set by ApplyGamePatches(). PublishSettings() keeps it up to date for as
+ * long as the caps stay the same, since the site can't be repatched after.
+ */
+extern float *SkillCapDirectSlot;
+
+bool SkillCapsAreUniform(void);
+
+void PublishSettings(Settings *next);
 
 #endif /* __SKYRIM_UNCAPPER_AE_SETTINGS_H__ */
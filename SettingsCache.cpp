@@ -0,0 +1,134 @@
+/**
+ * @file SettingsCache.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Reads and writes the parsed settings cache.
+ * @bug No known bugs.
+ *
+ * The cache is a header holding the key it was created with, followed by the
+ * settings as serialized by Settings::WriteCache(). The payload is hashed, so
+ * a damaged file is never deserialized. Any mismatch causes the caller to
+ * fall back to parsing the INI.
+ */
+
+#include "SettingsCache.h"
+
+#include <Windows.h>
+
+#include "CacheFile.h"
+
+/// @brief Identifies a settings cache file ("USET").
+static const uint32_t kSettingsCacheMagic = 0x54455355;
+
+/// @brief Must be incremented whenever the layout of the file or the
+///        serialized settings changes.
+static const uint32_t kSettingsCacheFormat = 3;
+
+/// @brief The largest payload which may be valid. The settings are never
+///        anywhere near this large, so anything bigger must be garbage.
+static const size_t kMaxPayloadSize = 64 << 20;
+
+/// @brief The header at the start of the cache.
+struct SettingsCacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    SettingsCacheKey key;
+    uint64_t payload_size;
+    uint64_t payload_hash;
+};
+
+/**
+ * @brief Computes the 64-bit FNV-1a hash of the given bytes.
+ */
+static uint64_t
+HashPayload(
+    const unsigned char *data,
+    size_t size
+) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Creates the cache key for the INI file at the given path.
+ *
+ * Only the fields describing the file are filled in. The config version must
+ * be set by the caller.
+ *
+ * @return True if the key was created, false if the INI could not be found.
+ */
+bool
+GetSettingsCacheKey(
+    const std::string &ini_path,
+    SettingsCacheKey &key
+) {
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(ini_path.c_str(), GetFileExInfoStandard, &info)) {
+        return false;
+    }
+
+    // Cleared first so the padding in the file is deterministic.
+    memset(&key, 0, sizeof(key));
+    key.ini_size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32)
+                 | info.nFileSizeLow;
+    key.ini_mtime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32)
+                  | info.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+/**
+ * @brief Reads the settings which were cached with the given key.
+ * @param path The path of the cache file.
+ * @param key The key the settings must have been cached with.
+ * @param payload Returns the serialized settings.
+ * @return True if the settings were read, false if the cache could not be used.
+ */
+bool
+ReadSettingsCache(
+    const std::string &path,
+    const SettingsCacheKey &key,
+    std::vector<unsigned char> &payload
+) {
+    std::vector<unsigned char> buf;
+    if (!ReadCacheFile(path, sizeof(SettingsCacheHeader) + kMaxPayloadSize, buf)) {
+        return false;
+    }
+
+    SettingsCacheHeader header;
+    if (!ReadCacheHeader(buf, kSettingsCacheMagic, kSettingsCacheFormat, header)
+            || (header.key.ini_size != key.ini_size)
+            || (header.key.ini_mtime != key.ini_mtime)
+            || (header.key.config_version != key.config_version)
+            || (header.payload_size != (buf.size() - sizeof(header)))) {
+        return false;
+    }
+
+    payload.assign(buf.begin() + sizeof(header), buf.end());
+    return HashPayload(payload.data(), payload.size()) == header.payload_hash;
+}
+
+/**
+ * @brief Writes the given settings to the cache with the given key.
+ * @param path The path of the cache file.
+ * @param key The key to store the settings with.
+ * @param payload The serialized settings.
+ * @return True if the cache was written, false otherwise.
+ */
+bool
+WriteSettingsCache(
+    const std::string &path,
+    const SettingsCacheKey &key,
+    const std::vector<unsigned char> &payload
+) {
+    auto header = MakeCacheHeader<SettingsCacheHeader>(kSettingsCacheMagic, kSettingsCacheFormat);
+    header.key.ini_size = key.ini_size;
+    header.key.ini_mtime = key.ini_mtime;
+    header.key.config_version = key.config_version;
+    header.payload_size = payload.size();
+    header.payload_hash = HashPayload(payload.data(), payload.size());
+
+    return WriteCacheFile(path, &header, sizeof(header), payload.data(), payload.size());
+}
@@ -0,0 +1,172 @@
+/**
+ * @file SettingsCache.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes the cache which stores parsed settings between launches of
+ *        the game.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_SETTINGS_CACHE_H__
+#define __SKYRIM_UNCAPPER_AE_SETTINGS_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Identifies the INI file a set of cached settings was parsed from.
+ *
+ * If any of these change, the cached settings must not be used.
+ */
+struct SettingsCacheKey {
+    uint64_t ini_size;
+    uint64_t ini_mtime;
+    uint32_t config_version;
+};
+
+/**
+ * @brief Serializes settings into a flat buffer.
+ */
+class SettingsCacheWriter {
+  private:
+    std::vector<unsigned char> buf;
+
+  public:
+    SettingsCacheWriter() {}
+
+    /**
+     * @brief Appends the given bytes to the buffer.
+     */
+    void
+    Write(
+        const void *data,
+        size_t size
+    ) {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+        buf.insert(buf.end(), bytes, bytes + size);
+    }
+
+    /**
+     * @brief Appends a trivially copyable value to the buffer.
+     */
+    template <typename T>
+    void
+    Write(
+        const T &val
+    ) {
+        static_assert(std::is_trivially_copyable<T>::value, "Value must be flat");
+        Write(&val, sizeof(val));
+    }
+
+    /**
+     * @brief Appends a string, prefixed with its length, to the buffer.
+     */
+    void
+    Write(
+        const std::string &val
+    ) {
+        Write(static_cast<uint64_t>(val.size()));
+        Write(val.data(), val.size());
+    }
+
+    /**
+     * @brief Gets the serialized settings.
+     */
+    inline const std::vector<unsigned char> &
+    Data() const {
+        return buf;
+    }
+};
+
+/**
+ * @brief Deserializes settings from a flat buffer.
+ *
+ * Reads never run past the end of the buffer. Once a read fails, every later
+ * read also fails.
+ */
+class SettingsCacheReader {
+  private:
+    const unsigned char *pos;
+    const unsigned char *end;
+
+  public:
+    explicit SettingsCacheReader(
+        const std::vector<unsigned char> &buf
+    ) : pos(buf.data()),
+        end(buf.data() + buf.size())
+    {}
+
+    /**
+     * @brief Gets the next size bytes of the buffer without copying them.
+     * @return The bytes, or null if the buffer is too short.
+     */
+    const void *
+    Take(
+        size_t size
+    ) {
+        if (!pos || (static_cast<size_t>(end - pos) < size)) {
+            pos = nullptr;
+            return nullptr;
+        }
+
+        const unsigned char *ret = pos;
+        pos += size;
+        return ret;
+    }
+
+    /**
+     * @brief Reads a trivially copyable value from the buffer.
+     * @return True if the value was read, false otherwise.
+     */
+    template <typename T>
+    bool
+    Read(
+        T &val
+    ) {
+        static_assert(std::is_trivially_copyable<T>::value, "Value must be flat");
+        const void *data = Take(sizeof(val));
+        if (data) {
+            memcpy(&val, data, sizeof(val));
+        }
+        return data != nullptr;
+    }
+
+    /**
+     * @brief Reads a string which was prefixed with its length.
+     * @return True if the string was read, false otherwise.
+     */
+    bool
+    Read(
+        std::string &val
+    ) {
+        uint64_t size;
+        if (!Read(size)) {
+            return false;
+        }
+
+        const void *data = Take(static_cast<size_t>(size));
+        if (data) {
+            val.assign(reinterpret_cast<const char*>(data), static_cast<size_t>(size));
+        }
+        return data != nullptr;
+    }
+
+    /**
+     * @brief Checks if every byte of the buffer was read without error.
+     */
+    inline bool
+    Done() const {
+        return pos == end;
+    }
+};
+
+bool GetSettingsCacheKey(const std::string &ini_path, SettingsCacheKey &key);
+bool ReadSettingsCache(const std::string &path, const SettingsCacheKey &key,
+                       std::vector<unsigned char> &payload);
+bool WriteSettingsCache(const std::string &path, const SettingsCacheKey &key,
+                        const std::vector<unsigned char> &payload);
+
+#endif /* __SKYRIM_UNCAPPER_AE_SETTINGS_CACHE_H__ */
@@ -43,6 +43,21 @@ SkillSlot::FromAttribute(
     return static_cast<t>(static_cast<int>(attr) - kOffset);
 }
 
+/**
+ * @brief Converts the given player skill enumeration to a skill ID.
+ *
+ * The provided slot must be valid.
+ *
+ * @param slot The slot to be converted.
+ */
+ActorAttribute::t
+SkillSlot::ToAttribute(
+    t slot
+) {
+    ASSERT(static_cast<unsigned int>(slot) < kCount);
+    return static_cast<ActorAttribute::t>(static_cast<int>(slot) + kOffset);
+}
+
 /**
  * @brief Converts the given skill type to a string.
  *
@@ -53,6 +53,7 @@ class SkillSlot {
 
   public:
     static t FromAttribute(ActorAttribute::t attr);
+    static ActorAttribute::t ToAttribute(t slot);
     static const char *Str(t slot);
 };
 
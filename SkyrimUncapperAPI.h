@@ -0,0 +1,108 @@
+/**
+ * @file SkyrimUncapperAPI.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief The messages which other SKSE plugins may send to the uncapper.
+ * @bug No known bugs.
+ *
+ * This header has no dependencies on the rest of the plugin, so it may be
+ * copied into other projects as is.
+ *
+ * Messages are sent with SKSEMessagingInterface::Dispatch(), addressed to
+ * SkyrimUncapperAPI::kPluginName. They are handled before Dispatch() returns,
+ * so any results may be read straight back out of the message data. Since
+ * they modify the player, messages must be sent from the game's main thread
+ * (e.g. from an SKSE task).
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_API_H__
+#define __SKYRIM_UNCAPPER_AE_API_H__
+
+#include <cstdint>
+
+/**
+ * @brief A single award of skill exp.
+ */
+struct SkyrimUncapperSkillExp {
+    /// @brief The actor value ID of the skill.
+    uint32_t skill;
+
+    /// @brief The exp to award, before the uncapper's multipliers.
+    float exp;
+};
+
+/**
+ * @brief The data of a kMessage_AwardSkillExp message.
+ *
+ * The entries are applied as if each had been awarded by the game in turn,
+ * except that every multiplier is taken from the skill levels and settings at
+ * the start of the batch. Entries for the same skill are summed and given to
+ * the game together, so a batch costs at most one game call per skill.
+ */
+struct SkyrimUncapperSkillExpBatch {
+    /// @brief Must be set to SkyrimUncapperAPI::kVersion.
+    uint32_t version;
+
+    /// @brief The number of entries in awards.
+    uint32_t count;
+
+    /// @brief The entries to apply.
+    const SkyrimUncapperSkillExp *awards;
+
+    /// @brief Returns the number of entries which were applied. Entries which
+    ///        are not skills, or do not award a positive amount of exp, are
+    ///        skipped. Nothing is applied if the uncapper's exp multipliers
+    ///        are disabled, or if the game has yet to award the player any
+    ///        skill exp since it was launched.
+    uint32_t applied;
+};
+
+/**
+ * @brief The data of a kMessage_ApplyAttributeLevelUps message.
+ *
+ * Gives the player the attribute gains of several level ups at once, as if
+ * the same choice had been made at each of them. This is meant for catching
+ * a player up across many levels. The player level itself is not changed.
+ */
+struct SkyrimUncapperAttributeLevelUps {
+    /// @brief Must be set to SkyrimUncapperAPI::kVersion.
+    uint32_t version;
+
+    /// @brief The player level of the first level up.
+    uint32_t first_level;
+
+    /// @brief The number of level ups to apply. The last level up must not be
+    ///        past level 65535, the highest level the game can store.
+    uint32_t count;
+
+    /// @brief The actor value ID of health, magicka, or stamina.
+    uint32_t choice;
+
+    /// @brief Returns the number of level ups which were applied. This is
+    ///        either count, or 0 if the range or choice is not valid or the
+    ///        uncapper's attribute settings are disabled.
+    uint32_t applied;
+};
+
+/**
+ * @brief Describes how to reach the uncapper.
+ */
+class SkyrimUncapperAPI {
+  public:
+    /// @brief The name messages must be addressed to.
+    static constexpr const char *kPluginName = "SkyrimUncapperAE";
+
+    /// @brief The version of the message data in this header.
+    static const uint32_t kVersion = 1;
+
+    /// @brief The message types which the uncapper handles.
+    enum MessageType : uint32_t {
+        /// @brief Awards skill exp. The data is a SkyrimUncapperSkillExpBatch.
+        kMessage_AwardSkillExp = 0x55435801,
+
+        /// @brief Applies several attribute level ups. The data is a
+        ///        SkyrimUncapperAttributeLevelUps.
+        kMessage_ApplyAttributeLevelUps = 0x55435802
+    };
+};
+
+#endif /* __SKYRIM_UNCAPPER_AE_API_H__ */
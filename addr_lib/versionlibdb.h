@@ -1,7 +1,10 @@
 #pragma once
 
-#include <map>
+#include <vector>
+#include <string>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <stdio.h>
 #include <Windows.h>
 
@@ -13,20 +16,126 @@ public:
 	VersionDb() { Clear(); }
 	~VersionDb() { }
 
+	/// One id/offset pair of the address library.
+	struct Entry
+	{
+		unsigned long long id;
+		unsigned long long offset;
+	};
+
 private:
-	std::map<unsigned long long, unsigned long long> _data;
-	std::map<unsigned long long, unsigned long long> _rdata;
+	/// Sorted by id.
+	std::vector<Entry> _data;
+	/// Sorted by offset. Only built when a reverse lookup is requested.
+	mutable std::vector<Entry> _rdata;
 	int _ver[4];
 	std::string _verStr;
 	std::string _moduleName;
 	unsigned long long _base;
 
-	template <typename T>
-	static T read(std::ifstream& file)
+	/// Read-only view of the database file, unmapped when it goes out of scope.
+	class MappedFile
+	{
+	public:
+		MappedFile() : _file(INVALID_HANDLE_VALUE), _mapping(NULL), _view(NULL), _size(0) { }
+		~MappedFile() { Close(); }
+
+		bool Open(const char* path)
+		{
+			_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (_file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(_file, &size) || size.QuadPart <= 0)
+				return false;
+			_size = (size_t)size.QuadPart;
+
+			_mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (_mapping == NULL)
+				return false;
+
+			_view = (const unsigned char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+			return _view != NULL;
+		}
+
+		void Close()
+		{
+			if (_view != NULL)
+				UnmapViewOfFile(_view);
+			if (_mapping != NULL)
+				CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE)
+				CloseHandle(_file);
+
+			_view = NULL;
+			_mapping = NULL;
+			_file = INVALID_HANDLE_VALUE;
+			_size = 0;
+		}
+
+		const unsigned char* Data() const { return _view; }
+		size_t Size() const { return _size; }
+
+	private:
+		HANDLE _file;
+		HANDLE _mapping;
+		const unsigned char* _view;
+		size_t _size;
+	};
+
+	/// Bounds checked cursor over a mapped database file.
+	class Reader
+	{
+	public:
+		Reader(const unsigned char* data, size_t size) : _cur(data), _end(data + size), _good(true) { }
+
+		template <typename T>
+		T read()
+		{
+			T v = T();
+			if ((size_t)(_end - _cur) < sizeof(T))
+			{
+				_good = false;
+				_cur = _end;
+				return v;
+			}
+
+			memcpy(&v, _cur, sizeof(T));
+			_cur += sizeof(T);
+			return v;
+		}
+
+		const char* skip(size_t len)
+		{
+			if ((size_t)(_end - _cur) < len)
+			{
+				_good = false;
+				_cur = _end;
+				return NULL;
+			}
+
+			const char* ret = (const char*)_cur;
+			_cur += len;
+			return ret;
+		}
+
+		bool good() const { return _good; }
+
+	private:
+		const unsigned char* _cur;
+		const unsigned char* _end;
+		bool _good;
+	};
+
+	static bool LessById(const Entry& a, const Entry& b)
+	{
+		return a.id < b.id;
+	}
+
+	static bool LessByOffset(const Entry& a, const Entry& b)
 	{
-		T v;
-		file.read((char*)&v, sizeof(T));
-		return v;
+		return a.offset < b.offset;
 	}
 
 	static void* ToPointer(unsigned long long v)
@@ -38,18 +147,150 @@ private:
 	{
 		return (unsigned long long)ptr;
 	}
-	
+
 	static bool ParseVersionFromString(const char* ptr, int& major, int& minor, int& revision, int& build)
 	{
 		return sscanf_s(ptr, "%d.%d.%d.%d", &major, &minor, &revision, &build) == 4 && ((major != 1 && major != 0) || minor != 0 || revision != 0 || build != 0);
 	}
 
+	/// Sorts the decoded entries by id. Later duplicates win, as they did
+	/// when the entries were kept in a map.
+	void SortData()
+	{
+		bool sorted = true;
+		for (size_t i = 1; i < _data.size() && sorted; i++)
+			sorted = _data[i - 1].id < _data[i].id;
+		if (sorted)
+			return;
+
+		std::stable_sort(_data.begin(), _data.end(), LessById);
+
+		size_t out = 0;
+		for (size_t i = 0; i < _data.size(); i++)
+		{
+			if (out > 0 && _data[out - 1].id == _data[i].id)
+				_data[out - 1] = _data[i];
+			else
+				_data[out++] = _data[i];
+		}
+		_data.resize(out);
+	}
+
+	/**
+	 * Decodes the delta encoded database stream, handing each id/offset pair
+	 * to visit() in file order. Decoding stops early if visit() returns false.
+	 */
+	template <typename F>
+	bool Decode(const char* fileName, F visit)
+	{
+		MappedFile mapped;
+		if (!mapped.Open(fileName))
+			return false;
+
+		Reader file(mapped.Data(), mapped.Size());
+
+		int format = file.read<int>();
+
+		if (format != 2)
+			return false;
+
+		for (int i = 0; i < 4; i++)
+			_ver[i] = file.read<int>();
+
+		{
+			char verName[64];
+			_snprintf_s(verName, 64, "%d.%d.%d.%d", _ver[0], _ver[1], _ver[2], _ver[3]);
+			_verStr = verName;
+		}
+
+		int tnLen = file.read<int>();
+
+		if (tnLen < 0 || tnLen >= 0x10000)
+			return false;
+
+		if (tnLen > 0)
+		{
+			const char* tn = file.skip(tnLen);
+			if (tn == NULL)
+				return false;
+			_moduleName.assign(tn, tnLen);
+		}
+
+		{
+			HMODULE handle = GetModuleHandleA(_moduleName.empty() ? NULL : _moduleName.c_str());
+			_base = (unsigned long long)handle;
+		}
+
+		int ptrSize = file.read<int>();
+
+		int addrCount = file.read<int>();
+
+		if (!file.good() || ptrSize <= 0 || addrCount < 0)
+			return false;
+
+		unsigned char type, low, high;
+		unsigned char b1, b2;
+		unsigned short w1, w2;
+		unsigned int d1, d2;
+		unsigned long long q1, q2;
+		unsigned long long pvid = 0;
+		unsigned long long poffset = 0;
+		unsigned long long tpoffset;
+		for (int i = 0; i < addrCount; i++)
+		{
+			type = file.read<unsigned char>();
+			low = type & 0xF;
+			high = type >> 4;
+
+			switch (low)
+			{
+			case 0: q1 = file.read<unsigned long long>(); break;
+			case 1: q1 = pvid + 1; break;
+			case 2: b1 = file.read<unsigned char>(); q1 = pvid + b1; break;
+			case 3: b1 = file.read<unsigned char>(); q1 = pvid - b1; break;
+			case 4: w1 = file.read<unsigned short>(); q1 = pvid + w1; break;
+			case 5: w1 = file.read<unsigned short>(); q1 = pvid - w1; break;
+			case 6: w1 = file.read<unsigned short>(); q1 = w1; break;
+			case 7: d1 = file.read<unsigned int>(); q1 = d1; break;
+			default: return false;
+			}
+
+			tpoffset = (high & 8) != 0 ? (poffset / (unsigned long long)ptrSize) : poffset;
+
+			switch (high & 7)
+			{
+			case 0: q2 = file.read<unsigned long long>(); break;
+			case 1: q2 = tpoffset + 1; break;
+			case 2: b2 = file.read<unsigned char>(); q2 = tpoffset + b2; break;
+			case 3: b2 = file.read<unsigned char>(); q2 = tpoffset - b2; break;
+			case 4: w2 = file.read<unsigned short>(); q2 = tpoffset + w2; break;
+			case 5: w2 = file.read<unsigned short>(); q2 = tpoffset - w2; break;
+			case 6: w2 = file.read<unsigned short>(); q2 = w2; break;
+			case 7: d2 = file.read<unsigned int>(); q2 = d2; break;
+			}
+
+			if ((high & 8) != 0)
+				q2 *= (unsigned long long)ptrSize;
+
+			if (!file.good())
+				return false;
+
+			if (!visit(q1, q2))
+				break;
+
+			poffset = q2;
+			pvid = q1;
+		}
+
+		return true;
+	}
+
 public:
 
 	const std::string& GetModuleName() const { return _moduleName; }
 	const std::string& GetLoadedVersionString() const { return _verStr; }
 
-	const std::map<unsigned long long, unsigned long long>& GetOffsetMap() const
+	const std::vector<Entry>& GetOffsets() const
 	{
 		return _data;
 	}
@@ -69,10 +310,11 @@ public:
 
 	bool FindOffsetById(unsigned long long id, unsigned long long& result) const
 	{
-		auto itr = _data.find(id);
-		if (itr != _data.end())
+		Entry key = { id, 0 };
+		auto itr = std::lower_bound(_data.begin(), _data.end(), key, LessById);
+		if (itr != _data.end() && itr->id == id)
 		{
-			result = itr->second;
+			result = itr->offset;
 			return true;
 		}
 		return false;
@@ -90,11 +332,20 @@ public:
 
 	bool FindIdByOffset(unsigned long long offset, unsigned long long& result) const
 	{
-		auto itr = _rdata.find(offset);
-		if (itr == _rdata.end())
+		if (_rdata.size() != _data.size())
+		{
+			_rdata = _data;
+			std::stable_sort(_rdata.begin(), _rdata.end(), LessByOffset);
+		}
+
+		// Several ids may share an offset; the highest one wins, as it did
+		// with the old reverse map.
+		Entry key = { 0, offset };
+		auto itr = std::upper_bound(_rdata.begin(), _rdata.end(), key, LessByOffset);
+		if (itr == _rdata.begin() || (itr - 1)->offset != offset)
 			return false;
 
-		result = itr->second;
+		result = (itr - 1)->id;
 		return true;
 	}
 
@@ -147,6 +398,25 @@ public:
 		return false;
 	}
 
+	static std::string GetFileName(int major, int minor, int revision, int build)
+	{
+		char fileName[256];
+		_snprintf_s(fileName, 256, "Data\\SKSE\\Plugins\\versionlib-%d-%d-%d-%d.bin", major, minor, revision, build);
+		return fileName;
+	}
+
+	/// Gets the path of the database for the running executable.
+	bool GetFileName(std::string& fileName) const
+	{
+		int major, minor, revision, build;
+
+		if (!GetExecutableVersion(major, minor, revision, build))
+			return false;
+
+		fileName = GetFileName(major, minor, revision, build);
+		return true;
+	}
+
 	void GetLoadedVersion(int& major, int& minor, int& revision, int& build) const
 	{
 		major = _ver[0];
@@ -158,7 +428,9 @@ public:
 	void Clear()
 	{
 		_data.clear();
+		_data.shrink_to_fit();
 		_rdata.clear();
+		_rdata.shrink_to_fit();
 		for (int i = 0; i < 4; i++) _ver[i] = 0;
 		_moduleName = std::string();
 		_base = 0;
@@ -167,7 +439,7 @@ public:
 	bool Load()
 	{
 		int major, minor, revision, build;
-		
+
 		if (!GetExecutableVersion(major, minor, revision, build))
 			return false;
 
@@ -178,106 +450,73 @@ public:
 	{
 		Clear();
 
-		char fileName[256];
-		_snprintf_s(fileName, 256, "Data\\SKSE\\Plugins\\versionlib-%d-%d-%d-%d.bin", major, minor, revision, build);
-
-		std::ifstream file(fileName, std::ios::binary);
-		if (!file.good())
-			return false;
+		std::string fileName = GetFileName(major, minor, revision, build);
 
-		int format = read<int>(file);
-
-		if (format != 2)
-			return false;
-
-		for (int i = 0; i < 4; i++)
-			_ver[i] = read<int>(file);
+		bool ok = Decode(fileName.c_str(), [this](unsigned long long id, unsigned long long offset) {
+			_data.push_back({ id, offset });
+			return true;
+		});
 
+		if (!ok)
 		{
-			char verName[64];
-			_snprintf_s(verName, 64, "%d.%d.%d.%d", _ver[0], _ver[1], _ver[2], _ver[3]);
-			_verStr = verName;
-		}
-
-		int tnLen = read<int>(file);
-
-		if (tnLen < 0 || tnLen >= 0x10000)
+			Clear();
 			return false;
-
-		if(tnLen > 0)
-		{
-			char* tnbuf = (char*)malloc(tnLen + 1);
-			file.read(tnbuf, tnLen);
-			tnbuf[tnLen] = '\0';
-			_moduleName = tnbuf;
-			free(tnbuf);
 		}
 
-		{
-			HMODULE handle = GetModuleHandleA(_moduleName.empty() ? NULL : _moduleName.c_str());
-			_base = (unsigned long long)handle;
-		}
+		SortData();
+		return true;
+	}
 
-		int ptrSize = read<int>(file);
+	/**
+	 * Loads only the given ids from the database of the running executable.
+	 * The stream is still decoded in order, but nothing else is kept and
+	 * decoding stops as soon as every requested id has been seen.
+	 */
+	bool Load(const unsigned long long* ids, size_t count)
+	{
+		int major, minor, revision, build;
 
-		int addrCount = read<int>(file);
+		if (!GetExecutableVersion(major, minor, revision, build))
+			return false;
 
-		unsigned char type, low, high;
-		unsigned char b1, b2;
-		unsigned short w1, w2;
-		unsigned int d1, d2;
-		unsigned long long q1, q2;
-		unsigned long long pvid = 0;
-		unsigned long long poffset = 0;
-		unsigned long long tpoffset;
-		for (int i = 0; i < addrCount; i++)
-		{
-			type = read<unsigned char>(file);
-			low = type & 0xF;
-			high = type >> 4;
+		return Load(major, minor, revision, build, ids, count);
+	}
 
-			switch (low)
-			{
-			case 0: q1 = read<unsigned long long>(file); break;
-			case 1: q1 = pvid + 1; break;
-			case 2: b1 = read<unsigned char>(file); q1 = pvid + b1; break;
-			case 3: b1 = read<unsigned char>(file); q1 = pvid - b1; break;
-			case 4: w1 = read<unsigned short>(file); q1 = pvid + w1; break;
-			case 5: w1 = read<unsigned short>(file); q1 = pvid - w1; break;
-			case 6: w1 = read<unsigned short>(file); q1 = w1; break;
-			case 7: d1 = read<unsigned int>(file); q1 = d1; break;
-			default:
-			{
-				Clear();
-				return false;
-			}
-			}
+	bool Load(int major, int minor, int revision, int build, const unsigned long long* ids, size_t count)
+	{
+		Clear();
 
-			tpoffset = (high & 8) != 0 ? (poffset / (unsigned long long)ptrSize) : poffset;
+		std::vector<unsigned long long> wanted(ids, ids + count);
+		std::sort(wanted.begin(), wanted.end());
+		wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+		std::vector<bool> found(wanted.size(), false);
+		size_t remaining = wanted.size();
 
-			switch (high & 7)
+		std::string fileName = GetFileName(major, minor, revision, build);
+
+		_data.reserve(wanted.size());
+		bool ok = Decode(fileName.c_str(), [&](unsigned long long id, unsigned long long offset) {
+			auto itr = std::lower_bound(wanted.begin(), wanted.end(), id);
+			if (itr != wanted.end() && *itr == id)
 			{
-			case 0: q2 = read<unsigned long long>(file); break;
-			case 1: q2 = tpoffset + 1; break;
-			case 2: b2 = read<unsigned char>(file); q2 = tpoffset + b2; break;
-			case 3: b2 = read<unsigned char>(file); q2 = tpoffset - b2; break;
-			case 4: w2 = read<unsigned short>(file); q2 = tpoffset + w2; break;
-			case 5: w2 = read<unsigned short>(file); q2 = tpoffset - w2; break;
-			case 6: w2 = read<unsigned short>(file); q2 = w2; break;
-			case 7: d2 = read<unsigned int>(file); q2 = d2; break;
-			default: throw std::exception();
+				size_t idx = itr - wanted.begin();
+				if (!found[idx])
+				{
+					found[idx] = true;
+					remaining--;
+				}
+				_data.push_back({ id, offset });
 			}
+			return remaining > 0;
+		});
 
-			if ((high & 8) != 0)
-				q2 *= (unsigned long long)ptrSize;
-
-			_data[q1] = q2;
-			_rdata[q2] = q1;
-
-			poffset = q2;
-			pvid = q1;
+		if (!ok)
+		{
+			Clear();
+			return false;
 		}
 
+		SortData();
 		return true;
 	}
 
@@ -290,10 +529,10 @@ public:
 		for (auto itr = _data.begin(); itr != _data.end(); itr++)
 		{
 			f << std::dec;
-			f << itr->first;
+			f << itr->id;
 			f << '\t';
 			f << std::hex;
-			f << itr->second;
+			f << itr->offset;
 			f << '\n';
 		}
 
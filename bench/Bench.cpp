@@ -0,0 +1,333 @@
+/**
+ * @file Bench.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Microbenchmarks for the settings lookups used by our hooks.
+ * @bug No known bugs.
+ *
+ * This is built by SkyrimUncapperBench.vcxproj, which links the settings code
+ * against stubbed game functions so that it can run without the game.
+ *
+ * For each synthetic INI size, the benchmark writes an INI file whose leveled
+ * sections hold that many entries, reads it, and then times each lookup over
+ * a fixed set of pseudo-random levels. Levels inside the precomputed table and
+ * levels past it are timed separately, since the latter still binary search.
+ *
+ * Usage: SkyrimUncapperBench.exe [directory for the generated INI files]
+ *        SkyrimUncapperBench.exe --replay <trace file> <INI file>
+ *
+ * The second form replays a recorded hook trace instead. See Replay.cpp.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "IDebugLog.h"
+
+#include "ActorAttribute.h"
+#include "RelocFn.h"
+#include "RelocFnStub.h"
+#include "Replay.h"
+#include "Settings.h"
+#include "SkillSlot.h"
+
+IDebugLog gLog;
+
+/// @brief The number of entries in each leveled section of each synthetic INI.
+static const unsigned int kIniSizes[] = { 0, 10, 100, 1000, 10000 };
+
+/// @brief The number of levels each lookup benchmark cycles through.
+static const size_t kNumLevels = 4096;
+
+/// @brief The number of lookups timed by each benchmark.
+static const size_t kIterations = 10000000;
+
+/// @brief The number of times each INI is read by the ReadConfig benchmark.
+static const size_t kReadIterations = 10;
+
+/// @brief The leveled sections which are not per-skill.
+static const char *const kLeveledSections[] = {
+    "PerksAtLevelUp",
+    "HealthAtLevelUp",
+    "HealthAtMagickaLevelUp",
+    "HealthAtStaminaLevelUp",
+    "MagickaAtLevelUp",
+    "MagickaAtHealthLevelUp",
+    "MagickaAtStaminaLevelUp",
+    "StaminaAtLevelUp",
+    "StaminaAtHealthLevelUp",
+    "StaminaAtMagickaLevelUp",
+    "CarryWeightAtHealthLevelUp",
+    "CarryWeightAtMagickaLevelUp",
+    "CarryWeightAtStaminaLevelUp"
+};
+
+/// @brief The prefixes of the per-skill leveled sections.
+static const char *const kSkillLeveledSections[] = {
+    "SkillExpGainMults\\CharacterLevel\\",
+    "SkillExpGainMults\\BaseSkillLevel\\",
+    "LevelSkillExpMults\\CharacterLevel\\",
+    "LevelSkillExpMults\\BaseSkillLevel\\"
+};
+
+/// @brief Keeps the results of each benchmark alive.
+static volatile double benchSink;
+
+/**
+ * @brief Writes a leveled section with the given number of entries.
+ */
+static void
+WriteLeveledSection(
+    FILE *f,
+    const char *section,
+    const char *subsection,
+    unsigned int entries
+) {
+    fprintf(f, "[%s%s]\n", section, subsection);
+    for (unsigned int i = 0; i < entries; i++) {
+        fprintf(f, "%u = %u\n", i + 1, 1 + (i % 7));
+    }
+}
+
+/**
+ * @brief Writes a synthetic INI file whose leveled sections each hold the
+ *        given number of entries.
+ * @return True if the file was written, false otherwise.
+ */
+static bool
+WriteSyntheticIni(
+    const std::string &path,
+    unsigned int entries
+) {
+    FILE *f = nullptr;
+    if (fopen_s(&f, path.c_str(), "w") || !f) {
+        return false;
+    }
+
+    // Keep the version current, so reading the INI doesn't rewrite it.
+    fprintf(f, "[General]\nVersion = %d\n", CONFIG_VERSION);
+
+    for (const char *section : kLeveledSections) {
+        WriteLeveledSection(f, section, "", entries);
+    }
+
+    for (const char *section : kSkillLeveledSections) {
+        for (int i = 0; i < SkillSlot::kCount; i++) {
+            const char *skill = SkillSlot::Str(static_cast<SkillSlot::t>(i));
+            WriteLeveledSection(f, section, skill, entries);
+        }
+    }
+
+    fclose(f);
+    return true;
+}
+
+/**
+ * @brief Fills the given list with pseudo-random levels in [lo, hi).
+ */
+static void
+MakeLevels(
+    std::vector<unsigned int> &levels,
+    unsigned int lo,
+    unsigned int hi
+) {
+    uint32_t state = 0x2545F491;
+    levels.resize(kNumLevels);
+    for (auto &level : levels) {
+        state = state * 1664525 + 1013904223;
+        level = lo + ((state >> 8) % (hi - lo));
+    }
+}
+
+/**
+ * @brief Times the given lookup over the given levels and prints the result.
+ * @param name The name of the benchmark.
+ * @param levels The levels to cycle the lookup through.
+ * @param fn The lookup, which takes a level and returns a value to be kept.
+ */
+template <typename F>
+static void
+RunBenchmark(
+    const char *name,
+    const std::vector<unsigned int> &levels,
+    F fn
+) {
+    double acc = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kIterations; i++) {
+        acc += fn(levels[i & (kNumLevels - 1)]);
+    }
+    auto end = std::chrono::steady_clock::now();
+    benchSink = acc;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("  %-40s %8.2f ns/op\n", name, ns / kIterations);
+}
+
+/**
+ * @brief Runs every lookup benchmark over the given levels.
+ * @param settings The settings to benchmark.
+ * @param range The name of the level range.
+ * @param levels The levels to cycle through.
+ */
+static void
+RunLookupBenchmarks(
+    const Settings &settings,
+    const char *range,
+    const std::vector<unsigned int> &levels
+) {
+    printf(" %s\n", range);
+
+    RunBenchmark("GetSkillExpGainMult", levels, [&](unsigned int level) {
+        return settings.GetSkillExpGainMult(ActorAttribute::Sneak, level, level);
+    });
+
+    RunBenchmark("GetLevelSkillExpMult", levels, [&](unsigned int level) {
+        return settings.GetLevelSkillExpMult(ActorAttribute::Sneak, level, level);
+    });
+
+    RunBenchmark("GetPerkDelta", levels, [&](unsigned int level) {
+        return settings.GetPerkDelta(level);
+    });
+
+    // Every skill at once, as a skill exp batch needs.
+    RunBenchmark("GetSkillExpGainMults", levels, [&](unsigned int level) {
+        unsigned int skill_levels[SkillSlot::kCount];
+        for (int i = 0; i < SkillSlot::kCount; i++) {
+            skill_levels[i] = level;
+        }
+
+        float mults[SkillSlot::kCount];
+        settings.GetSkillExpGainMults(skill_levels, level, mults);
+        return mults[0] + mults[SkillSlot::kCount - 1];
+    });
+
+    RunBenchmark("GetAttributeLevelUp", levels, [&](unsigned int level) {
+        ActorAttributeLevelUp level_up;
+        settings.GetAttributeLevelUp(level, ActorAttribute::Health, level_up);
+        return level_up.health + level_up.carry_weight;
+    });
+
+    // A catch-up from level 1, as a setlevel would need.
+    RunBenchmark("GetAttributeLevelUpRange", levels, [&](unsigned int level) {
+        ActorAttributeLevelUp level_up;
+        settings.GetAttributeLevelUpRange(1, level, ActorAttribute::Health, level_up);
+        return level_up.health + level_up.carry_weight;
+    });
+
+    // PlayerAVOGetCurrent_Hook() without and with the guard it takes on every
+    // call, so the cost of the guard itself can be read off.
+    RunBenchmark("ClampSkillFormula", levels, [&](unsigned int level) {
+        return settings.ClampSkillFormula(ActorAttribute::Sneak, static_cast<float>(level));
+    });
+
+    RunBenchmark("ClampSkillFormula (guarded)", levels, [&](unsigned int level) {
+        SettingsGuard guard;
+        return guard.Get().ClampSkillFormula(ActorAttribute::Sneak, static_cast<float>(level));
+    });
+
+    // Shaped like ImprovePlayerSkillPoints_Hook(), through the stubbed game.
+    RunBenchmark("ImprovePlayerSkillPoints (stubbed)", levels, [&](unsigned int level) {
+        stubPlayerLevel = level;
+        stubPlayerAVOBase[ActorAttribute::Sneak] = static_cast<float>(level);
+        return settings.GetSkillExpGainMult(
+            ActorAttribute::Sneak,
+            static_cast<unsigned int>(PlayerAVOGetBase(ActorAttribute::Sneak)),
+            GetPlayerLevel()
+        );
+    });
+}
+
+/**
+ * @brief Benchmarks the settings read from an INI with the given number of
+ *        entries in each leveled section.
+ * @return True if the benchmark could run, false otherwise.
+ */
+static bool
+RunIniBenchmarks(
+    const std::string &dir,
+    unsigned int entries
+) {
+    std::string path = dir + "SkyrimUncapperBench_" + std::to_string(entries) + ".ini";
+    if (!WriteSyntheticIni(path, entries)) {
+        printf("Failed to write %s\n", path.c_str());
+        return false;
+    }
+
+    printf("%u entries per leveled section:\n", entries);
+
+    // The first read of each iteration parses the INI, as the cache is
+    // removed beforehand. The second is served from the cache it wrote.
+    const std::string cache_path = path + ".cache";
+    Settings *settings = nullptr;
+    double parse_ms = 0, cached_ms = 0;
+    for (size_t i = 0; i < kReadIterations * 2; i++) {
+        bool parse = !(i & 1);
+        if (parse) {
+            remove(cache_path.c_str());
+        }
+
+        delete settings;
+        settings = new Settings();
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = settings->ReadConfig(path);
+        auto end = std::chrono::steady_clock::now();
+        if (!ok) {
+            printf("Failed to read %s\n", path.c_str());
+            delete settings;
+            return false;
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        (parse ? parse_ms : cached_ms) += ms;
+    }
+
+    printf("  %-40s %8.2f ms/op\n", "ReadConfig (parsed)", parse_ms / kReadIterations);
+    printf("  %-40s %8.2f ms/op\n", "ReadConfig (cached)", cached_ms / kReadIterations);
+
+    // The guarded benchmarks read the published settings, which own their
+    // copy. Publishing the next copy frees this one.
+    PublishSettings(new Settings(*settings));
+
+    std::vector<unsigned int> levels;
+    MakeLevels(levels, 0, LEVELED_SETTING_TABLE_SIZE);
+    RunLookupBenchmarks(*settings, "Table levels:", levels);
+
+    MakeLevels(levels, LEVELED_SETTING_TABLE_SIZE, LEVELED_SETTING_TABLE_SIZE + entries + 64);
+    RunLookupBenchmarks(*settings, "Searched levels:", levels);
+
+    delete settings;
+    return true;
+}
+
+int
+main(
+    int argc,
+    char **argv
+) {
+    gLog.Open("SkyrimUncapperBench.log");
+
+    if ((argc > 1) && !strcmp(argv[1], "--replay")) {
+        if (argc != 4) {
+            printf("Usage: %s --replay <trace file> <INI file>\n", argv[0]);
+            return 1;
+        }
+        return ReplayHookTrace(argv[2], argv[3]) ? 0 : 1;
+    }
+
+    std::string dir = (argc > 1) ? argv[1] : ".";
+    if ((dir.back() != '\\') && (dir.back() != '/')) {
+        dir += '\\';
+    }
+
+    for (unsigned int entries : kIniSizes) {
+        if (!RunIniBenchmarks(dir, entries)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
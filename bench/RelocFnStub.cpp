@@ -0,0 +1,105 @@
+/**
+ * @file RelocFnStub.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Stand-ins for the game functions in RelocFn.h and HookWrappers.h.
+ * @bug No known bugs.
+ *
+ * The benchmark has no game to call into, so these return values set by the
+ * benchmark instead. Nothing here is meant to be fast or accurate; it only
+ * needs to cost about as little as the real calls do.
+ */
+
+#include "RelocFn.h"
+#include "RelocFnStub.h"
+#include "HookWrappers.h"
+
+unsigned int stubPlayerLevel = 1;
+float stubPlayerAVOBase[ActorAttribute::CarryWeight + 1];
+float stubPlayerAVOCurrent[ActorAttribute::CarryWeight + 1];
+double stubSkillExp;
+
+/// @brief The values returned by GetFloatGameSetting().
+static float stubGameSettings[GameSetting::kCount];
+
+void
+CacheGameSettings() {}
+
+float *
+GetFloatGameSetting(
+    GameSetting::t var
+) {
+    return &stubGameSettings[var];
+}
+
+UInt16
+GetPlayerLevel() {
+    return static_cast<UInt16>(stubPlayerLevel);
+}
+
+void *
+GetPlayerActorValueOwner() {
+    return nullptr;
+}
+
+float
+PlayerAVOGetBase(
+    ActorAttribute::t attr
+) {
+    return stubPlayerAVOBase[attr];
+}
+
+float
+PlayerAVOGetCurrent_Original(
+    void *av,
+    ActorAttribute::t attr
+) {
+    (void)av;
+    return stubPlayerAVOCurrent[attr];
+}
+
+void
+PlayerAVOModBase(
+    ActorAttribute::t attr,
+    float val
+) {
+    stubPlayerAVOBase[attr] += val;
+}
+
+void
+PlayerAVOModCurrent(
+    UInt32 unk1,
+    ActorAttribute::t attr,
+    float val
+) {
+    (void)unk1;
+    (void)attr;
+    (void)val;
+}
+
+void
+PlayerAVOApplyLevelUp(
+    const ActorAttributeLevelUp &level_up
+) {
+    stubPlayerAVOBase[ActorAttribute::Health] += level_up.health;
+    stubPlayerAVOBase[ActorAttribute::Magicka] += level_up.magicka;
+    stubPlayerAVOBase[ActorAttribute::Stamina] += level_up.stamina;
+}
+
+void
+ImprovePlayerSkillPoints_Original(
+    void *skill_data,
+    ActorAttribute::t skill,
+    float exp,
+    UInt64 unk1,
+    UInt32 unk2,
+    UInt8 unk3,
+    bool unk4
+) {
+    (void)skill_data;
+    (void)skill;
+    (void)unk1;
+    (void)unk2;
+    (void)unk3;
+    (void)unk4;
+    stubSkillExp += exp;
+}
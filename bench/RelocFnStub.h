@@ -0,0 +1,26 @@
+/**
+ * @file RelocFnStub.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes the state returned by the stubbed game functions.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_RELOC_FN_STUB_H__
+#define __SKYRIM_UNCAPPER_AE_RELOC_FN_STUB_H__
+
+#include "ActorAttribute.h"
+
+/// @brief The level returned by GetPlayerLevel().
+extern unsigned int stubPlayerLevel;
+
+/// @brief The values returned by PlayerAVOGetBase(), indexed by attribute.
+extern float stubPlayerAVOBase[ActorAttribute::CarryWeight + 1];
+
+/// @brief The values returned by PlayerAVOGetCurrent_Original(), indexed by
+///        attribute.
+extern float stubPlayerAVOCurrent[ActorAttribute::CarryWeight + 1];
+
+/// @brief The total exp passed to ImprovePlayerSkillPoints_Original().
+extern double stubSkillExp;
+
+#endif /* __SKYRIM_UNCAPPER_AE_RELOC_FN_STUB_H__ */
@@ -0,0 +1,178 @@
+/**
+ * @file Replay.cpp
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Replays a recorded hook trace through the hook bodies.
+ * @bug No known bugs.
+ *
+ * Traces are recorded by a build with SKYRIM_UNCAPPER_TRACE defined. Each
+ * record sets the stubbed game state to what the game returned during the
+ * capture, and then calls the real hook from Hook_Skill.cpp. This gives the
+ * hot paths the call mix and level distribution of an actual play session,
+ * rather than the uniform levels used by the synthetic benchmarks.
+ *
+ * Note that the player cache is never initialized here, so the hooks read the
+ * stubbed game state on every call.
+ */
+
+#include "Replay.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "ActorAttribute.h"
+#include "Hook_Skill.h"
+#include "HookProfile.h"
+#include "HookTrace.h"
+#include "RelocFnStub.h"
+#include "Settings.h"
+
+/// @brief The number of times the trace is replayed.
+static const unsigned int kReplayPasses = 20;
+
+/// @brief Keeps the results of the replay alive.
+static volatile double replaySink;
+
+/**
+ * @brief Reads every record in the given trace file.
+ * @return True if the trace was read, false otherwise.
+ */
+static bool
+ReadHookTrace(
+    const std::string &path,
+    std::vector<HookTraceRecord> &records
+) {
+    FILE *f = nullptr;
+    if (fopen_s(&f, path.c_str(), "rb") || !f) {
+        printf("Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    HookTraceHeader header;
+    if ((fread(&header, sizeof(header), 1, f) != 1)
+            || (header.magic != HOOK_TRACE_MAGIC)
+            || (header.version != HOOK_TRACE_VERSION)
+            || (header.record_size != sizeof(HookTraceRecord))) {
+        printf("%s is not a supported hook trace.\n", path.c_str());
+        fclose(f);
+        return false;
+    }
+
+    HookTraceRecord record;
+    while (fread(&record, sizeof(record), 1, f) == 1) {
+        if ((record.hook >= HookProfile::kCount)
+                || (record.attr > ActorAttribute::CarryWeight)) {
+            printf("%s contains an invalid record.\n", path.c_str());
+            fclose(f);
+            return false;
+        }
+        records.push_back(record);
+    }
+
+    fclose(f);
+    return true;
+}
+
+/**
+ * @brief Feeds a single record through its hook.
+ * @return The value the hook produced, so that it can be kept alive.
+ */
+static double
+ReplayRecord(
+    const HookTraceRecord &record
+) {
+    ActorAttribute::t attr = static_cast<ActorAttribute::t>(record.attr);
+
+    switch (record.hook) {
+        case HookProfile::PlayerAVOGetCurrent:
+            stubPlayerAVOCurrent[attr] = record.val;
+            return PlayerAVOGetCurrent_Hook(nullptr, attr);
+        case HookProfile::ImprovePlayerSkillPoints:
+            stubPlayerLevel = record.player_level;
+            stubPlayerAVOBase[attr] = record.skill_level;
+            ImprovePlayerSkillPoints_Hook(nullptr, attr, record.val, 0, 0, 0, false);
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Replays the given trace with the settings from the given INI, and
+ *        prints the call mix and the time taken per call.
+ * @return True if the trace could be replayed, false otherwise.
+ */
+bool
+ReplayHookTrace(
+    const std::string &trace_path,
+    const std::string &ini_path
+) {
+    Settings *settings = new Settings();
+    if (!settings->ReadConfig(ini_path)) {
+        printf("Failed to read %s\n", ini_path.c_str());
+        delete settings;
+        return false;
+    }
+    PublishSettings(settings);
+
+    std::vector<HookTraceRecord> records;
+    if (!ReadHookTrace(trace_path, records)) {
+        return false;
+    }
+
+    // The exp hook is only installed when the exp patch is enabled, and it
+    // asserts as much.
+    if (!settings->IsSkillExpEnabled()) {
+        size_t kept = 0;
+        for (const HookTraceRecord &record : records) {
+            if (record.hook != HookProfile::ImprovePlayerSkillPoints) {
+                records[kept++] = record;
+            }
+        }
+        printf("Skill exp is disabled; dropped %zu exp records.\n", records.size() - kept);
+        records.resize(kept);
+    }
+
+    if (records.empty()) {
+        printf("%s contains no records.\n", trace_path.c_str());
+        return false;
+    }
+
+    size_t calls[HookProfile::kCount] = { 0 };
+    for (const HookTraceRecord &record : records) {
+        calls[record.hook]++;
+    }
+
+    printf("Replaying %zu calls from %s:\n", records.size(), trace_path.c_str());
+    for (int i = 0; i < HookProfile::kCount; i++) {
+        if (calls[i]) {
+            printf(
+                "  %-32s %10zu calls (%5.1f%%)\n",
+                HookProfile::Str(static_cast<HookProfile::t>(i)),
+                calls[i],
+                100.0 * calls[i] / records.size()
+            );
+        }
+    }
+
+    double acc = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int pass = 0; pass < kReplayPasses; pass++) {
+        for (const HookTraceRecord &record : records) {
+            acc += ReplayRecord(record);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    replaySink = acc + stubSkillExp;
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    double total_calls = static_cast<double>(records.size()) * kReplayPasses;
+    printf(
+        "  %-32s %8.2f ns/call %8.2f Mcalls/s\n",
+        "All hooks",
+        ns / total_calls,
+        total_calls * 1000.0 / ns
+    );
+
+    return true;
+}
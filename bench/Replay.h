@@ -0,0 +1,15 @@
+/**
+ * @file Replay.h
+ * @author Andrew Spaulding (Kasplat)
+ * @brief Exposes the hook trace replayer.
+ * @bug No known bugs.
+ */
+
+#ifndef __SKYRIM_UNCAPPER_AE_REPLAY_H__
+#define __SKYRIM_UNCAPPER_AE_REPLAY_H__
+
+#include <string>
+
+bool ReplayHookTrace(const std::string &trace_path, const std::string &ini_path);
+
+#endif /* __SKYRIM_UNCAPPER_AE_REPLAY_H__ */
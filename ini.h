@@ -12,6 +12,9 @@
 
 #include "simpleini/SimpleIni.h"
 
+#include "IniWriter.h"
+#include "SettingsCache.h"
+
 /**
  * @brief Gets the character prefix of a type.
  */
@@ -79,7 +82,7 @@ ReadIniValue<std::string>(
  */
 ///@{
 template <typename T> inline void SaveIniValue(
-    CSimpleIniA &ini,
+    IniWriter &ini,
     const char *section,
     const char *key,
     T val,
@@ -88,46 +91,46 @@ template <typename T> inline void SaveIniValue(
 
 template <> inline void
 SaveIniValue<float>(
-    CSimpleIniA &ini,
+    IniWriter &ini,
     const char *section,
     const char *key,
     float val,
     const char *comment
 ) {
-    ASSERT(ini.SetDoubleValue(section, key, val, comment));
+    ini.Write(section, key, val, comment);
 }
 
 template <> inline void
 SaveIniValue<unsigned int>(
-    CSimpleIniA &ini,
+    IniWriter &ini,
     const char *section,
     const char *key,
     unsigned int val,
     const char *comment
 ) {
-    ASSERT(ini.SetLongValue(section, key, val, comment));
+    ini.Write(section, key, val, comment);
 }
 
 template <> inline void
 SaveIniValue<bool>(
-    CSimpleIniA &ini,
+    IniWriter &ini,
     const char *section,
     const char *key,
     bool val,
     const char *comment
 ) {
-    ASSERT(ini.SetBoolValue(section, key, val, comment));
+    ini.Write(section, key, val, comment);
 }
 
 template <> inline void
 SaveIniValue<std::string>(
-    CSimpleIniA &ini,
+    IniWriter &ini,
     const char *section,
     const char *key,
     std::string val,
     const char *comment
 ) {
-    ASSERT(ini.SetValue(section, key, val.c_str(), comment));
+    ini.Write(section, key, val.c_str(), comment);
 }
 ///@}
 
@@ -151,10 +154,18 @@ class SectionField {
      * @brief Gets the value of the field.
      */
     inline T
-    Get() {
+    Get() const {
         return val;
     }
 
+    /**
+     * @brief Gets the INI key of the field.
+     */
+    inline const char *
+    GetName() const {
+        return name;
+    }
+
     /**
      * @brief Sets the value of the field.
      */
@@ -185,12 +196,33 @@ class SectionField {
      */
     void
     SaveConfig(
-        CSimpleIniA &ini,
+        IniWriter &ini,
         const char *section,
         const char *comment
     ) {
         SaveIniValue(ini, section, name, val, comment);
     }
+
+    /**
+     * @brief Writes the value to the given settings cache.
+     */
+    void
+    WriteCache(
+        SettingsCacheWriter &cache
+    ) const {
+        cache.Write(val);
+    }
+
+    /**
+     * @brief Reads the value from the given settings cache.
+     * @return True if the value was read, false otherwise.
+     */
+    bool
+    ReadCache(
+        SettingsCacheReader &cache
+    ) {
+        return cache.Read(val);
+    }
 };
 
 #endif /* __SKYRIM_UNCAPPER_AE_INI_H__ */
@@ -9,13 +9,20 @@
  */
 
 #include <ShlObj.h>
-#include "BranchTrampoline.h"
 #include "Utilities.h"
 #include "PluginAPI.h"
 #include "skse_version.h"
 
+#include "ConfigWatcher.h"
+#include "Hook_Skill.h"
+#include "HookProfile.h"
+#include "HookTrace.h"
+#include "PhaseTimer.h"
+#include "PlayerCache.h"
+#include "RelocFn.h"
 #include "RelocPatch.h"
 #include "Settings.h"
+#include "SkyrimUncapperAPI.h"
 
 #define DLL_EXPORT __declspec(dllexport)
 
@@ -23,6 +30,16 @@ IDebugLog gLog;
 HINSTANCE gDllHandle;
 UInt32    g_pluginHandle = kPluginHandle_Invalid;
 
+#ifdef SKYRIM_UNCAPPER_PROFILE
+/// @brief How often, in milliseconds, the hook profile is written to the log.
+static const unsigned int kHookProfileDumpPeriod = 60000;
+#endif
+
+#ifdef SKYRIM_UNCAPPER_TRACE
+/// @brief How often, in milliseconds, the hook trace is written to disk.
+static const unsigned int kHookTraceFlushPeriod = 5000;
+#endif
+
 static bool GetDllDirWithSlash(std::string& path)
 {
     char dllPath[4096]; // with \\?\ prefix path can be longer than MAX_PATH, so just using some magic number
@@ -44,6 +61,73 @@ static bool GetDllDirWithSlash(std::string& path)
     return true;
 }
 
+static void SkyrimUncapper_MessageHandler(SKSEMessagingInterface::Message* msg)
+{
+    switch (msg->type) {
+        case SKSEMessagingInterface::kMessage_DataLoaded:
+            // The game settings collection is ready now, so we can stop
+            // looking settings up by name.
+            CacheGameSettings();
+            break;
+    }
+}
+
+/**
+ * @brief Handles the messages other plugins send us through SkyrimUncapperAPI.h.
+ */
+static void SkyrimUncapper_ApiHandler(SKSEMessagingInterface::Message* msg)
+{
+    switch (msg->type) {
+        case SkyrimUncapperAPI::kMessage_AwardSkillExp: {
+            if (!msg->data || (msg->dataLen < sizeof(SkyrimUncapperSkillExpBatch))) {
+                _WARNING("Ignoring malformed skill exp batch from %s.", msg->sender);
+                break;
+            }
+
+            auto batch = static_cast<SkyrimUncapperSkillExpBatch*>(msg->data);
+            if (batch->version != SkyrimUncapperAPI::kVersion) {
+                _WARNING(
+                    "Ignoring skill exp batch of version %u from %s.",
+                    batch->version,
+                    msg->sender
+                );
+                batch->applied = 0;
+                break;
+            }
+
+            batch->applied = static_cast<UInt32>(
+                AwardSkillExpBatch(batch->awards, batch->count)
+            );
+            break;
+        }
+        case SkyrimUncapperAPI::kMessage_ApplyAttributeLevelUps: {
+            if (!msg->data || (msg->dataLen < sizeof(SkyrimUncapperAttributeLevelUps))) {
+                _WARNING("Ignoring malformed attribute level ups from %s.", msg->sender);
+                break;
+            }
+
+            auto level_ups = static_cast<SkyrimUncapperAttributeLevelUps*>(msg->data);
+            if (level_ups->version != SkyrimUncapperAPI::kVersion) {
+                _WARNING(
+                    "Ignoring attribute level ups of version %u from %s.",
+                    level_ups->version,
+                    msg->sender
+                );
+                level_ups->applied = 0;
+                break;
+            }
+
+            bool applied = ApplyAttributeLevelUps(
+                level_ups->first_level,
+                level_ups->count,
+                static_cast<ActorAttribute::t>(level_ups->choice)
+            );
+            level_ups->applied = applied ? level_ups->count : 0;
+            break;
+        }
+    }
+}
+
 static bool SkyrimUncapper_Initialize(const SKSEInterface* skse)
 {
     static bool isInit = false;
@@ -53,6 +137,7 @@ static bool SkyrimUncapper_Initialize(const SKSEInterface* skse)
     }
     isInit = true;
 
+    PhaseTimer init_timer;
     gLog.OpenRelative(
         CSIDL_MYDOCUMENTS,
         "\\My Games\\Skyrim Special Edition\\SKSE\\SkyrimUncapper.log"
@@ -68,21 +153,68 @@ static bool SkyrimUncapper_Initialize(const SKSEInterface* skse)
     );
     _MESSAGE("imagebase = %016I64X", img_base);
 
-    std::string path;
-    if (!GetDllDirWithSlash(path)) {
+    std::string dir;
+    if (!GetDllDirWithSlash(dir)) {
         return false;
     }
 
-    path += "SkyrimUncapper.ini";
-    if (!settings.ReadConfig(path)) {
+    // Decoding the address library doesn't depend on the config, so we do it
+    // on a worker thread while the INI is parsed. The two are joined in
+    // ApplyGamePatches().
+    LocateGamePatches(skse->runtimeVersion, dir + "SkyrimUncapper.offsets");
+
+    const std::string ini_path = dir + "SkyrimUncapper.ini";
+    Settings *settings = new Settings();
+    PhaseTimer config_timer;
+    if (!settings->ReadConfig(ini_path)) {
+        delete settings;
+        AbandonGamePatches();
         return false;
     }
+    config_timer.Log("Settings::ReadConfig");
+    PublishSettings(settings);
 
-    if (ApplyGamePatches(img_base, skse->runtimeVersion) < 0) {
+#ifdef SKYRIM_UNCAPPER_TRACE
+    // Opened before patching, so that no calls are missed.
+    if (HookTrace::Open(dir + "SkyrimUncapper.trace")) {
+        HookTrace::StartPeriodicFlush(kHookTraceFlushPeriod);
+    }
+#endif
+
+    if (ApplyGamePatches(img_base) < 0) {
         _ERROR("Failed to apply game patches. See log for details.");
         return false;
     }
 
+    auto messaging = static_cast<SKSEMessagingInterface*>(
+        skse->QueryInterface(kInterface_Messaging)
+    );
+    if (!messaging || !messaging->RegisterListener(g_pluginHandle, "SKSE", SkyrimUncapper_MessageHandler)) {
+        _WARNING("Couldn't register for SKSE messages. Game settings will be cached on first use.");
+    }
+
+    // Other plugins may be loaded after us, so we listen to all of them.
+    if (!messaging || !messaging->RegisterListener(g_pluginHandle, nullptr, SkyrimUncapper_ApiHandler)) {
+        _WARNING("Couldn't register for plugin messages. Skill exp batches will be ignored.");
+    }
+
+    auto tasks = static_cast<SKSETaskInterface*>(
+        skse->QueryInterface(kInterface_Task)
+    );
+    if (!tasks) {
+        _WARNING("Couldn't get the SKSE task interface. Player values will not be cached.");
+    }
+    InitPlayerCache(tasks);
+
+    if (settings->IsConfigHotReloadEnabled()) {
+        StartConfigWatcher(ini_path, tasks);
+    }
+
+#ifdef SKYRIM_UNCAPPER_PROFILE
+    HookProfile::StartPeriodicDump(kHookProfileDumpPeriod, tasks);
+#endif
+
+    init_timer.Log("SkyrimUncapper_Initialize");
     _MESSAGE("Init complete");
     return true;
 }